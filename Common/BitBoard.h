@@ -0,0 +1,397 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "LifeEngine.h"
+
+/**
+	Bit-packed board: 64 cells per 64-bit word, one row is a run of words.
+	Cell x of row y is bit (x % 64) of word (x / 64). Bits past the board width in the last word of a row are kept zero.
+
+	The step kernel counts neighbours of 64 cells at once with adder logic instead of reading eight cells one by one:
+		1. vertical sums of the three rows are made for every column (full adder per bit, 2 bit result)
+		2. left and right column sums are shifted in from the neighbouring words
+		3. the three 2 bit column sums are added with full and half adders into a 4 bit neighbour count
+		4. the rule picks the counts that give an alive cell, one equality mask per count that is in the rule
+
+	The kernel is a template over the rule type (see Rule.h), common rules get their own copy with the rule folded in.
+*/
+
+//Counts set bits of a word
+inline int popcount64(uint64_t v)
+{
+#if defined(_MSC_VER)
+	//__popcnt needs a cpu with POPCNT so use the plain bit trick on msvc
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((v * 0x0101010101010101ULL) >> 56);
+#else
+	return __builtin_popcountll(v);
+#endif
+}
+
+//Grows bounds over the set bits of count words of row y, bit 0 of words[0] is cell x, only call it when one is set
+inline void addBitRowBounds(const uint64_t *words, int count, long long x, long long y, CellBounds &bounds)
+{
+	int first = 0;
+	while (first < count - 1 && !words[first])
+	{
+		first++;
+	}
+	int last = count - 1;
+	while (last > first && !words[last])
+	{
+		last--;
+	}
+	bounds.addRow(y, x + first * 64 + lowestBit64(words[first]), x + last * 64 + highestBit64(words[last]));
+}
+
+//Vertical sum of three rows for 64 columns at once: lo is the 1 bit, hi the 2 bit of the sum
+inline void columnSum(uint64_t above, uint64_t row, uint64_t below, uint64_t &lo, uint64_t &hi)
+{
+	lo = above ^ row ^ below;
+	hi = (above & row) | (above & below) | (row & below);
+}
+
+//Next state of 64 cells from their 4 bit neighbour counts n3 n2 n1 n0 and their current state
+template<class RuleType>
+inline uint64_t applyRule(const RuleType &rule, uint64_t n0, uint64_t n1, uint64_t n2, uint64_t n3, uint64_t self)
+{
+	uint64_t born = 0;
+	uint64_t stay = 0;
+	for (int n = 0; n <= 8; n++) //unrolled and folded when the rule is a StaticRule
+	{
+		bool birth = (rule.birth >> n) & 1;
+		bool survive = (rule.survive >> n) & 1;
+		if (!birth && !survive)
+		{
+			continue;
+		}
+		uint64_t count = ((n & 1) ? n0 : ~n0) & ((n & 2) ? n1 : ~n1) & ((n & 4) ? n2 : ~n2) & ((n & 8) ? n3 : ~n3);
+		born |= birth ? count : 0;
+		stay |= survive ? count : 0;
+	}
+	return (born & ~self) | (stay & self);
+}
+
+//B3/S23: alive with 2 or 3 neighbours or dead with exactly 3
+inline uint64_t applyRule(const StaticRule<0x008, 0x00C> &, uint64_t n0, uint64_t n1, uint64_t n2, uint64_t n3, uint64_t self)
+{
+	return n1 & ~n2 & ~n3 & (n0 | self);
+}
+
+//Computes words firstWord..lastWord-1 of the next generation of one packed row from the rows above and below it
+//(use a zero row outside the board). words is the length of the whole row, lastMask clears the bits past the board
+//width in its last word. rowCell is the cell index of the first cell of the row for the hash.
+//Alive and survivor counts and the hash change are added to stats.
+template<class RuleType>
+inline void stepBitWords(const RuleType &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out, int firstWord, int lastWord, int words, uint64_t lastMask, uint64_t rowCell, StepStats &stats)
+{
+	uint64_t prevLo = 0, prevHi = 0; //column sums of word w-1
+	uint64_t curLo, curHi;			 //column sums of word w
+	if (firstWord > 0)
+	{
+		columnSum(above[firstWord - 1], row[firstWord - 1], below[firstWord - 1], prevLo, prevHi);
+	}
+	columnSum(above[firstWord], row[firstWord], below[firstWord], curLo, curHi);
+
+	for (int w = firstWord; w < lastWord; w++)
+	{
+		uint64_t nextLo = 0, nextHi = 0; //column sums of word w+1
+		if (w + 1 < words)
+		{
+			columnSum(above[w + 1], row[w + 1], below[w + 1], nextLo, nextHi);
+		}
+
+		//left column: cell x-1 moves to bit x, right column: cell x+1 moves to bit x
+		uint64_t leftLo = (curLo << 1) | (prevLo >> 63);
+		uint64_t leftHi = (curHi << 1) | (prevHi >> 63);
+		uint64_t rightLo = (curLo >> 1) | (nextLo << 63);
+		uint64_t rightHi = (curHi >> 1) | (nextHi << 63);
+
+		//middle column without the cell itself
+		uint64_t midLo = above[w] ^ below[w];
+		uint64_t midHi = above[w] & below[w];
+
+		//add the three 2 bit column sums into a 4 bit neighbour count n3 n2 n1 n0 (0-8)
+		uint64_t n0 = leftLo ^ midLo ^ rightLo;
+		uint64_t carry1 = (leftLo & midLo) | (leftLo & rightLo) | (midLo & rightLo);
+		uint64_t sum2 = leftHi ^ midHi ^ rightHi;
+		uint64_t carry2 = (leftHi & midHi) | (leftHi & rightHi) | (midHi & rightHi);
+		uint64_t n1 = sum2 ^ carry1;
+		uint64_t carry3 = sum2 & carry1;
+		uint64_t n2 = carry2 ^ carry3;
+		uint64_t n3 = carry2 & carry3;
+
+		uint64_t self = row[w];
+		uint64_t next = applyRule(rule, n0, n1, n2, n3, self);
+		if (w == words - 1)
+		{
+			next &= lastMask;
+		}
+		out[w] = next;
+
+		stats.aliveCount += popcount64(next);
+		stats.survivors += popcount64(next & self);
+		if (next != self) //births and deaths
+		{
+			stats.hashDelta ^= zobristBits(rowCell + (uint64_t)w * 64, next ^ self);
+		}
+
+		prevLo = curLo;
+		prevHi = curHi;
+		curLo = nextLo;
+		curHi = nextHi;
+	}
+}
+
+//Computes the next generation of a whole packed row
+template<class RuleType>
+inline void stepBitRow(const RuleType &rule, const uint64_t *above, const uint64_t *row, const uint64_t *below, uint64_t *out, int words, uint64_t lastMask, uint64_t rowCell, StepStats &stats)
+{
+	stepBitWords(rule, above, row, below, out, 0, words, words, lastMask, rowCell, stats);
+}
+
+//Computes the next generation of a tile of 64 x 64 cells, one word per row, into out. columns holds rows -1..64 of
+//the tile column on the left, of the tile itself and of the tile column on the right (zero where there is nothing),
+//only the edge bits of the left and right columns are used. Stats and hash are left to the caller.
+template<class RuleType>
+inline void stepBitTile(const RuleType &rule, const uint64_t (&columns)[3][66], uint64_t *out)
+{
+	for (int r = 0; r < 64; r++)
+	{
+		const uint64_t *left = columns[0] + r, *middle = columns[1] + r, *right = columns[2] + r;
+		uint64_t prevLo, prevHi, curLo, curHi, nextLo, nextHi;
+		columnSum(left[0], left[1], left[2], prevLo, prevHi);
+		columnSum(middle[0], middle[1], middle[2], curLo, curHi);
+		columnSum(right[0], right[1], right[2], nextLo, nextHi);
+
+		//same adder network as stepBitWords on a row of three words
+		uint64_t leftLo = (curLo << 1) | (prevLo >> 63);
+		uint64_t leftHi = (curHi << 1) | (prevHi >> 63);
+		uint64_t rightLo = (curLo >> 1) | (nextLo << 63);
+		uint64_t rightHi = (curHi >> 1) | (nextHi << 63);
+		uint64_t midLo = middle[0] ^ middle[2];
+		uint64_t midHi = middle[0] & middle[2];
+
+		uint64_t n0 = leftLo ^ midLo ^ rightLo;
+		uint64_t carry1 = (leftLo & midLo) | (leftLo & rightLo) | (midLo & rightLo);
+		uint64_t sum2 = leftHi ^ midHi ^ rightHi;
+		uint64_t carry2 = (leftHi & midHi) | (leftHi & rightHi) | (midHi & rightHi);
+		uint64_t n1 = sum2 ^ carry1;
+		uint64_t carry3 = sum2 & carry1;
+		uint64_t n2 = carry2 ^ carry3;
+		uint64_t n3 = carry2 & carry3;
+
+		out[r] = applyRule(rule, n0, n1, n2, n3, middle[1]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Board of packed cells
+class BitBoard
+{
+public:
+	BitBoard() : m_width(0), m_height(0), m_wordsPerRow(0), m_lastMask(0) {}
+	BitBoard(int width, int height) { resize(width, height); }
+
+	//resizes and clears the board
+	void resize(int width, int height);
+
+	//sets every cell dead
+	void clear() { std::fill(m_words.begin(), m_words.end(), 0); }
+
+	bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+	void set(int x, int y, bool alive);
+
+	uint64_t *row(int y) { return &m_words[(size_t)y * m_wordsPerRow]; }
+	const uint64_t *row(int y) const { return &m_words[(size_t)y * m_wordsPerRow]; }
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	int wordsPerRow() const { return m_wordsPerRow; }
+	uint64_t lastMask() const { return m_lastMask; }
+
+	//dead row of wordsPerRow words for above the first and below the last row
+	const uint64_t *zeroRow() const { return m_zeroRow.data(); }
+
+	//number of alive cells
+	long long population() const;
+
+	//writes next generation into next, which must have the same size
+	StepStats step(BitBoard &next, const Rule &rule = Rule()) const;
+
+	//writes next generation of rows firstRow..lastRow-1 into next
+	template<class RuleType>
+	void stepRows(const RuleType &rule, BitBoard &next, int firstRow, int lastRow, StepStats &stats) const;
+
+	void swap(BitBoard &other);
+
+private:
+	int m_width;
+	int m_height;
+	int m_wordsPerRow;
+	uint64_t m_lastMask;			//valid bits of the last word in a row
+	std::vector<uint64_t> m_words;	//rows one after another
+	std::vector<uint64_t> m_zeroRow;//dead row used above the first and below the last row
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void BitBoard::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_wordsPerRow = (width + 63) / 64;
+	m_lastMask = (width % 64 == 0) ? ~0ULL : (1ULL << (width % 64)) - 1;
+	m_words.assign((size_t)m_wordsPerRow * height, 0);
+	m_zeroRow.assign(m_wordsPerRow, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void BitBoard::set(int x, int y, bool alive)
+{
+	uint64_t &word = row(y)[x >> 6];
+	uint64_t bit = 1ULL << (x & 63);
+	word = alive ? (word | bit) : (word & ~bit);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline long long BitBoard::population() const
+{
+	long long count = 0;
+	for (uint64_t word : m_words)
+	{
+		count += popcount64(word);
+	}
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats BitBoard::step(BitBoard &next, const Rule &rule) const
+{
+	StepStats stats;
+	withRule(rule, [&](const auto &ruleType)
+	{
+		stepRows(ruleType, next, 0, m_height, stats);
+	});
+	return stats;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class RuleType>
+inline void BitBoard::stepRows(const RuleType &rule, BitBoard &next, int firstRow, int lastRow, StepStats &stats) const
+{
+	if (m_wordsPerRow == 0) //empty board
+	{
+		return;
+	}
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		const uint64_t *above = (y > 0) ? row(y - 1) : m_zeroRow.data();
+		const uint64_t *below = (y + 1 < m_height) ? row(y + 1) : m_zeroRow.data();
+		long long alive = stats.aliveCount;
+		stepBitRow(rule, above, row(y), below, next.row(y), m_wordsPerRow, m_lastMask, (uint64_t)y * m_width, stats);
+		if (stats.aliveCount != alive)
+		{
+			addBitRowBounds(next.row(y), m_wordsPerRow, 0, y, stats.bounds);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void BitBoard::swap(BitBoard &other)
+{
+	std::swap(m_width, other.m_width);
+	std::swap(m_height, other.m_height);
+	std::swap(m_wordsPerRow, other.m_wordsPerRow);
+	std::swap(m_lastMask, other.m_lastMask);
+	m_words.swap(other.m_words);
+	m_zeroRow.swap(other.m_zeroRow);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Engine running the packed board, two boards are swapped every generation
+class BitBoardEngine : public LifeEngine
+{
+public:
+	const char *name() const override { return "bitpacked"; }
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setRule(const Rule &rule) override;
+
+	const BitBoard &board() const { return m_current; }
+
+private:
+	BitBoard m_current;
+	BitBoard m_next;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void BitBoardEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_current.resize(width, height);
+	m_next.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (cells[y * stride + x] == 1)
+			{
+				m_current.set(x, y, true);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void BitBoardEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_current.height(); y++)
+	{
+		for (int x = 0; x < m_current.width(); x++)
+		{
+			cells[y * stride + x] = m_current.get(x, y);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool BitBoardEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	m_rule = rule;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats BitBoardEngine::step()
+{
+	StepStats stats = forEachBand(m_current.height(), [&](int firstRow, int lastRow, StepStats &bandStats)
+	{
+		withRule(m_rule, [&](const auto &rule)
+		{
+			m_current.stepRows(rule, m_next, firstRow, lastRow, bandStats);
+		});
+	});
+	m_current.swap(m_next);
+	return stats;
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "LifeEngine.h"
+#include "CpuFeatures.h"
+#include "HaloGrid.h"
+
+/**
+	Byte per cell engine with vectorized neighbour counting.
+
+	The board is a HaloGrid of bytes, the ghost border lets the kernels load the eight neighbours of 32 (avx2)
+	or 16 (sse4.1) cells with plain unaligned loads and no edge checks. Any boundary mode works.
+	Cells that don't fill a whole vector at the end of a row go through the scalar kernel, so all variants give the same board.
+	Hosts without either instruction set run the rolling sum kernel, it walks the row keeping the vertical 3-sums of
+	the three columns under the window, so every cell costs three loads and a few adds instead of eight loads.
+
+	The rule is a lookup table in every kernel: the vector kernels look the neighbour count up in a birth and a
+	survive table with a byte shuffle, the scalar kernel shifts a 32-bit table holding both masks, and common rules
+	get scalar kernels with the table as a constant (see Rule.h).
+*/
+
+//Kernel for one row: above, row and below point at cell x = 0 and have a ghost cell at -1 and width,
+//rowCell is the cell index of x = 0 for the hash
+typedef void (*ByteRowKernel)(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats);
+
+//Birth mask in the low and survive mask in the high half, bit n + 16 * alive is the next state
+template<class RuleType>
+inline uint32_t ruleTable(const RuleType &rule)
+{
+	return (uint32_t)rule.birth | ((uint32_t)rule.survive << 16);
+}
+
+//Scalar kernel for cells from..to-1 of a row
+inline void stepByteCells(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int from, int to, uint64_t rowCell, StepStats &stats)
+{
+	const uint32_t table = ruleTable(rule);
+	for (int x = from; x < to; x++)
+	{
+		int nNeighbours = above[x - 1] + above[x] + above[x + 1] +
+						  row[x - 1]			   + row[x + 1] +
+						  below[x - 1] + below[x] + below[x + 1];
+
+		uint8_t alive = (uint8_t)((table >> (nNeighbours + 16 * row[x])) & 1);
+		out[x] = alive;
+		stats.aliveCount += alive;
+		stats.survivors += alive & row[x];
+		if (alive != row[x])
+		{
+			stats.hashDelta ^= zobristKey(rowCell + x);
+		}
+	}
+}
+
+//Scalar row kernel with a sliding window of column sums, the column entering on the right is the only new work per cell
+template<class RuleType>
+inline void stepByteRowScalar(const Rule &runtimeRule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	const uint32_t table = ruleTable(RuleType(runtimeRule)); //a constant for a StaticRule
+	int left = above[-1] + row[-1] + below[-1];
+	int middle = above[0] + row[0] + below[0];
+	int aliveCount = 0;
+	int survivors = 0;
+	for (int x = 0; x < width; x++)
+	{
+		int right = above[x + 1] + row[x + 1] + below[x + 1];
+		int nNeighbours = left + middle + right - row[x];
+
+		uint8_t alive = (uint8_t)((table >> (nNeighbours + 16 * row[x])) & 1);
+		out[x] = alive;
+		aliveCount += alive;
+		survivors += alive & row[x];
+		if (alive != row[x])
+		{
+			stats.hashDelta ^= zobristKey(rowCell + x);
+		}
+
+		left = middle;
+		middle = right;
+	}
+	stats.aliveCount += aliveCount;
+	stats.survivors += survivors;
+}
+
+#ifdef GOL_X86
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//16 byte table for a byte shuffle, byte n is 1 when bit n of mask is set
+inline __m128i byteRuleTable(uint16_t mask)
+{
+	alignas(16) uint8_t table[16] = {};
+	for (int n = 0; n <= 8; n++)
+	{
+		table[n] = (mask >> n) & 1;
+	}
+	return _mm_load_si128((const __m128i *)table);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//32 cells per instruction
+GOL_TARGET_AVX2 inline void stepByteRowAVX2(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i birthTable = _mm256_broadcastsi128_si256(byteRuleTable(rule.birth)); //shuffles look up per 128 bit lane
+	const __m256i surviveTable = _mm256_broadcastsi128_si256(byteRuleTable(rule.survive));
+	__m256i aliveSum = zero;
+	__m256i survivorSum = zero;
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i aboveLeft = _mm256_loadu_si256((const __m256i *)(above + x - 1));
+		__m256i aboveMid = _mm256_loadu_si256((const __m256i *)(above + x));
+		__m256i aboveRight = _mm256_loadu_si256((const __m256i *)(above + x + 1));
+		__m256i rowLeft = _mm256_loadu_si256((const __m256i *)(row + x - 1));
+		__m256i self = _mm256_loadu_si256((const __m256i *)(row + x));
+		__m256i rowRight = _mm256_loadu_si256((const __m256i *)(row + x + 1));
+		__m256i belowLeft = _mm256_loadu_si256((const __m256i *)(below + x - 1));
+		__m256i belowMid = _mm256_loadu_si256((const __m256i *)(below + x));
+		__m256i belowRight = _mm256_loadu_si256((const __m256i *)(below + x + 1));
+
+		//nothing alive around these cells, they all stay dead
+		__m256i any = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(aboveLeft, aboveMid), _mm256_or_si256(aboveRight, rowLeft)),
+									  _mm256_or_si256(_mm256_or_si256(self, rowRight), _mm256_or_si256(_mm256_or_si256(belowLeft, belowMid), belowRight)));
+		if (_mm256_testz_si256(any, any))
+		{
+			_mm256_storeu_si256((__m256i *)(out + x), zero);
+			continue;
+		}
+
+		__m256i nNeighbours = _mm256_add_epi8(_mm256_add_epi8(_mm256_add_epi8(aboveLeft, aboveMid), _mm256_add_epi8(aboveRight, rowLeft)),
+											  _mm256_add_epi8(_mm256_add_epi8(rowRight, belowLeft), _mm256_add_epi8(belowMid, belowRight)));
+
+		//both tables looked up by the count, the high bit of self * 128 picks survive for alive cells
+		__m256i born = _mm256_shuffle_epi8(birthTable, nNeighbours);
+		__m256i stay = _mm256_shuffle_epi8(surviveTable, nNeighbours);
+		__m256i next = _mm256_blendv_epi8(born, stay, _mm256_slli_epi16(self, 7));
+		_mm256_storeu_si256((__m256i *)(out + x), next);
+
+		//sum of absolute differences against zero adds the bytes into four 64 bit lanes
+		aliveSum = _mm256_add_epi64(aliveSum, _mm256_sad_epu8(next, zero));
+		survivorSum = _mm256_add_epi64(survivorSum, _mm256_sad_epu8(_mm256_and_si256(next, self), zero));
+
+		uint32_t changed = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, self));
+		if (changed)
+		{
+			stats.hashDelta ^= zobristBits(rowCell + x, changed);
+		}
+	}
+
+	alignas(32) uint64_t lanes[4];
+	_mm256_store_si256((__m256i *)lanes, aliveSum);
+	stats.aliveCount += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm256_store_si256((__m256i *)lanes, survivorSum);
+	stats.survivors += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	stepByteCells(rule, above, row, below, out, x, width, rowCell, stats);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//16 cells per instruction
+GOL_TARGET_SSE41 inline void stepByteRowSSE41(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i birthTable = byteRuleTable(rule.birth);
+	const __m128i surviveTable = byteRuleTable(rule.survive);
+	__m128i aliveSum = zero;
+	__m128i survivorSum = zero;
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i aboveLeft = _mm_loadu_si128((const __m128i *)(above + x - 1));
+		__m128i aboveMid = _mm_loadu_si128((const __m128i *)(above + x));
+		__m128i aboveRight = _mm_loadu_si128((const __m128i *)(above + x + 1));
+		__m128i rowLeft = _mm_loadu_si128((const __m128i *)(row + x - 1));
+		__m128i self = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i rowRight = _mm_loadu_si128((const __m128i *)(row + x + 1));
+		__m128i belowLeft = _mm_loadu_si128((const __m128i *)(below + x - 1));
+		__m128i belowMid = _mm_loadu_si128((const __m128i *)(below + x));
+		__m128i belowRight = _mm_loadu_si128((const __m128i *)(below + x + 1));
+
+		//nothing alive around these cells, they all stay dead
+		__m128i any = _mm_or_si128(_mm_or_si128(_mm_or_si128(aboveLeft, aboveMid), _mm_or_si128(aboveRight, rowLeft)),
+								   _mm_or_si128(_mm_or_si128(self, rowRight), _mm_or_si128(_mm_or_si128(belowLeft, belowMid), belowRight)));
+		if (_mm_testz_si128(any, any))
+		{
+			_mm_storeu_si128((__m128i *)(out + x), zero);
+			continue;
+		}
+
+		__m128i nNeighbours = _mm_add_epi8(_mm_add_epi8(_mm_add_epi8(aboveLeft, aboveMid), _mm_add_epi8(aboveRight, rowLeft)),
+										   _mm_add_epi8(_mm_add_epi8(rowRight, belowLeft), _mm_add_epi8(belowMid, belowRight)));
+
+		__m128i born = _mm_shuffle_epi8(birthTable, nNeighbours);
+		__m128i stay = _mm_shuffle_epi8(surviveTable, nNeighbours);
+		__m128i next = _mm_blendv_epi8(born, stay, _mm_slli_epi16(self, 7));
+		_mm_storeu_si128((__m128i *)(out + x), next);
+
+		aliveSum = _mm_add_epi64(aliveSum, _mm_sad_epu8(next, zero));
+		survivorSum = _mm_add_epi64(survivorSum, _mm_sad_epu8(_mm_and_si128(next, self), zero));
+
+		uint32_t changed = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(next, self)) & 0xFFFF;
+		if (changed)
+		{
+			stats.hashDelta ^= zobristBits(rowCell + x, changed);
+		}
+	}
+
+	alignas(16) uint64_t lanes[2];
+	_mm_store_si128((__m128i *)lanes, aliveSum);
+	stats.aliveCount += lanes[0] + lanes[1];
+	_mm_store_si128((__m128i *)lanes, survivorSum);
+	stats.survivors += lanes[0] + lanes[1];
+
+	stepByteCells(rule, above, row, below, out, x, width, rowCell, stats);
+}
+
+#endif // GOL_X86
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns the row kernel for the level and rule, levels the build can't run fall back to scalar
+inline ByteRowKernel byteRowKernel(SimdLevel level, const Rule &rule)
+{
+#ifdef GOL_X86
+	switch (level)
+	{
+	case SimdLevel::AVX2:
+		return stepByteRowAVX2;
+	case SimdLevel::SSE41:
+		return stepByteRowSSE41;
+	default:
+		break;
+	}
+#endif
+	return withRule(rule, [](const auto &ruleType) -> ByteRowKernel
+	{
+		return stepByteRowScalar<typename std::decay<decltype(ruleType)>::type>;
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Engine running the byte board with the best kernel the cpu supports
+class ByteBoardEngine : public LifeEngine
+{
+public:
+	//level can be lowered to compare kernels, it is never raised above what the cpu supports
+	explicit ByteBoardEngine(SimdLevel level = detectSimdLevel());
+
+	const char *name() const override { return "simd"; }
+	std::string describe() const override { return std::string("simd (") + simdLevelName(m_level) + " kernel)"; }
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setBoundary(Boundary boundary) override { m_grid.setBoundary(boundary); return boundary != Boundary::Infinite; }
+	bool setRule(const Rule &rule) override;
+
+	SimdLevel level() const { return m_level; }
+
+private:
+	SimdLevel m_level;
+	ByteRowKernel m_kernel;
+	HaloGrid<uint8_t> m_grid;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline ByteBoardEngine::ByteBoardEngine(SimdLevel level)
+{
+	m_level = ((int)level > (int)detectSimdLevel()) ? detectSimdLevel() : level;
+	m_kernel = byteRowKernel(m_level, m_rule);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool ByteBoardEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //multi-state rules run on the generations engine
+	{
+		return false;
+	}
+	m_rule = rule;
+	m_kernel = byteRowKernel(m_level, m_rule);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ByteBoardEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_grid.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		uint8_t *row = m_grid.row(y);
+		for (int x = 0; x < width; x++)
+		{
+			row[x] = cells[y * stride + x] == 1;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ByteBoardEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_grid.height(); y++)
+	{
+		const uint8_t *row = m_grid.row(y);
+		for (int x = 0; x < m_grid.width(); x++)
+		{
+			cells[y * stride + x] = row[x];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats ByteBoardEngine::step()
+{
+	m_grid.fillHalo();
+	StepStats stats = forEachBand(m_grid.height(), [&](int firstRow, int lastRow, StepStats &bandStats)
+	{
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			long long alive = bandStats.aliveCount;
+			m_kernel(m_rule, m_grid.row(y - 1), m_grid.row(y), m_grid.row(y + 1), m_grid.nextRow(y), m_grid.width(), (uint64_t)y * m_grid.width(), bandStats);
+			if (bandStats.aliveCount != alive)
+			{
+				addRowBounds(m_grid.nextRow(y), m_grid.width(), y, bandStats.bounds);
+			}
+		}
+	});
+	m_grid.swap();
+	return stats;
+}
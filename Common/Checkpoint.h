@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "HaloGrid.h"
+#include "Zobrist.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+	Binary checkpoint of a board that is written and read through a memory mapped file.
+
+	Layout, little endian:
+		CheckpointHeader, headerSize bytes (128 in version 1)
+		height rows of rowWords 64-bit words, cell x of a row is bit x % 64 of word x / 64, set bits are alive
+
+	The file is created at its full size and mapped, the board is packed straight into the mapping and the mapping is
+	dropped. Writing back is left to the page cache, so saving a large board costs about one pass over its cells.
+	The file is written under a temporary name and renamed over the old checkpoint, a crash in the middle of a save
+	never leaves a broken checkpoint behind. Reading maps the file and unpacks the rows into the board directly,
+	the Zobrist hash is recomputed on the way and compared against the header to catch damaged files.
+*/
+
+const char CHECKPOINT_MAGIC[8] = { 'G', 'O', 'L', 'C', 'K', 'P', 'T', '\0' };
+const uint32_t CHECKPOINT_VERSION = 1;
+const uint32_t CHECKPOINT_HEADER_SIZE = 128;
+
+struct CheckpointHeader
+{
+	char magic[8];			//CHECKPOINT_MAGIC
+	uint32_t version;		//CHECKPOINT_VERSION
+	uint32_t headerSize;	//offset of the first row from the start of the file
+	uint64_t width;
+	uint64_t height;
+	int64_t generation;
+	uint64_t hash;			//Zobrist hash of the board, cell index is y * width + x
+	uint32_t boundary;		//Boundary as number
+	uint32_t rowWords;		//64-bit words per row
+	char rule[32];			//rulestring, zero terminated
+	char reserved[CHECKPOINT_HEADER_SIZE - 88];
+};
+
+static_assert(sizeof(CheckpointHeader) == CHECKPOINT_HEADER_SIZE, "checkpoint header must keep its size");
+
+//copies the rulestring into the header, cut to fit
+inline void setCheckpointRule(CheckpointHeader &header, const std::string &rule)
+{
+	size_t length = rule.size() < sizeof(header.rule) - 1 ? rule.size() : sizeof(header.rule) - 1;
+	memcpy(header.rule, rule.data(), length);
+	header.rule[length] = '\0';
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Read or read-write mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile() : m_data(nullptr), m_size(0) {}
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	//creates or truncates the file to size bytes and maps it for writing
+	bool create(const std::string &path, uint64_t size);
+
+	//maps an existing file for reading
+	bool openRead(const std::string &path);
+
+	//unmaps the file, written pages are flushed by the system
+	void close();
+
+	unsigned char *data() { return m_data; }
+	const unsigned char *data() const { return m_data; }
+	uint64_t size() const { return m_size; }
+
+private:
+	unsigned char *m_data;
+	uint64_t m_size;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool MappedFile::create(const std::string &path, uint64_t size)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	CloseHandle(file); //mapping keeps the file open
+	if (!mapping)
+	{
+		return false;
+	}
+	m_data = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+	CloseHandle(mapping); //view keeps the mapping alive
+#else
+	int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+	{
+		return false;
+	}
+	if (ftruncate(file, (off_t)size) != 0)
+	{
+		::close(file);
+		return false;
+	}
+	void *data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	::close(file); //mapping keeps the file open
+	m_data = data == MAP_FAILED ? nullptr : (unsigned char *)data;
+#endif
+	m_size = m_data ? size : 0;
+	return m_data != nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool MappedFile::openRead(const std::string &path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+	m_data = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	m_size = m_data ? (uint64_t)fileSize.QuadPart : 0;
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+	void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	m_data = data == MAP_FAILED ? nullptr : (unsigned char *)data;
+	m_size = m_data ? (uint64_t)info.st_size : 0;
+#endif
+	return m_data != nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void MappedFile::close()
+{
+	if (!m_data)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap(m_data, (size_t)m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Moves from over to, replacing to if it exists
+inline bool replaceFile(const std::string &from, const std::string &to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Writes the int board (1 alive) as checkpoint, header describes the board, its magic, version and sizes are filled in
+inline bool saveCheckpoint(const std::string &path, CheckpointHeader header, const int *cells, int stride, std::string &error)
+{
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.headerSize = CHECKPOINT_HEADER_SIZE;
+	header.rowWords = (uint32_t)((header.width + 63) / 64);
+	header.rule[sizeof(header.rule) - 1] = '\0';
+	memset(header.reserved, 0, sizeof(header.reserved));
+
+	uint64_t size = CHECKPOINT_HEADER_SIZE + header.height * header.rowWords * 8;
+	std::string temporary = path + ".tmp";
+	MappedFile file;
+	if (!file.create(temporary, size))
+	{
+		error = "can't create " + temporary;
+		return false;
+	}
+	memcpy(file.data(), &header, sizeof(header));
+
+	uint64_t *words = (uint64_t *)(file.data() + CHECKPOINT_HEADER_SIZE);
+	for (uint64_t y = 0; y < header.height; y++)
+	{
+		const int *row = cells + y * stride;
+		uint64_t *out = words + y * header.rowWords;
+		for (uint64_t word = 0; word < header.rowWords; word++)
+		{
+			uint64_t first = word * 64;
+			uint64_t count = header.width - first < 64 ? header.width - first : 64;
+			uint64_t bits = 0;
+			for (uint64_t bit = 0; bit < count; bit++)
+			{
+				bits |= (uint64_t)(row[first + bit] == 1) << bit;
+			}
+			out[word] = bits;
+		}
+	}
+	file.close();
+
+	if (!replaceFile(temporary, path))
+	{
+		error = "can't replace " + path;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Mapped checkpoint file, open checks the header and loadCells unpacks the board
+class CheckpointReader
+{
+public:
+	//maps the file and checks its header, returns false with a message in error when it is not a usable checkpoint
+	bool open(const std::string &path, std::string &error);
+
+	const CheckpointHeader &header() const { return m_header; }
+
+	Boundary boundary() const { return m_header.boundary <= (uint32_t)Boundary::Infinite ? (Boundary)m_header.boundary : Boundary::Dead; }
+
+	//unpacks the board into cells (1 alive 0 dead) with rows stride apart, returns false if the hash does not match
+	bool loadCells(int *cells, int stride, std::string &error) const;
+
+private:
+	MappedFile m_file;
+	CheckpointHeader m_header;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckpointReader::open(const std::string &path, std::string &error)
+{
+	if (!m_file.openRead(path))
+	{
+		error = "can't open " + path;
+		return false;
+	}
+	if (m_file.size() < sizeof(CheckpointHeader))
+	{
+		error = path + " is too short for a checkpoint";
+		return false;
+	}
+	memcpy(&m_header, m_file.data(), sizeof(m_header));
+	if (memcmp(m_header.magic, CHECKPOINT_MAGIC, sizeof(m_header.magic)) != 0)
+	{
+		error = path + " is not a checkpoint";
+		return false;
+	}
+	if (m_header.version != CHECKPOINT_VERSION)
+	{
+		error = path + " has checkpoint version " + std::to_string(m_header.version) + ", only version " + std::to_string(CHECKPOINT_VERSION) + " is known";
+		return false;
+	}
+	if (m_header.headerSize < sizeof(CheckpointHeader) || m_header.rowWords != (m_header.width + 63) / 64 ||
+		m_file.size() < m_header.headerSize + m_header.height * m_header.rowWords * 8)
+	{
+		error = path + " is truncated or damaged";
+		return false;
+	}
+	m_header.rule[sizeof(m_header.rule) - 1] = '\0';
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckpointReader::loadCells(int *cells, int stride, std::string &error) const
+{
+	const uint64_t *words = (const uint64_t *)(m_file.data() + m_header.headerSize);
+	uint64_t hash = 0;
+	for (uint64_t y = 0; y < m_header.height; y++)
+	{
+		int *row = cells + y * stride;
+		const uint64_t *in = words + y * m_header.rowWords;
+		for (uint64_t word = 0; word < m_header.rowWords; word++)
+		{
+			uint64_t first = word * 64;
+			uint64_t count = m_header.width - first < 64 ? m_header.width - first : 64;
+			uint64_t bits = in[word];
+			if (count < 64)
+			{
+				bits &= ((uint64_t)1 << count) - 1;
+			}
+			for (uint64_t bit = 0; bit < count; bit++)
+			{
+				row[first + bit] = (int)((bits >> bit) & 1);
+			}
+			hash ^= zobristBits(y * m_header.width + first, bits);
+		}
+	}
+	if (hash != m_header.hash)
+	{
+		error = "checkpoint board does not match its hash";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+	Helpers for reading command line values, shared by the batch mode of the game and the benchmark.
+
+	Values are checked whole: a number with anything after it or outside of its range is refused, so a typo is reported
+	instead of running with half of the value.
+*/
+
+//reads whole string as number within min..max
+inline bool parseNumber(const std::string &s, long long min, long long max, long long &value)
+{
+	if (s.empty())
+	{
+		return false;
+	}
+	char *end = nullptr;
+	long long number = strtoll(s.c_str(), &end, 10);
+	if (*end != '\0' || number < min || number > max)
+	{
+		return false;
+	}
+	value = number;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//splits comma separated list
+inline std::vector<std::string> splitList(const std::string &s)
+{
+	std::vector<std::string> items;
+	std::string item;
+	for (char c : s)
+	{
+		if (c == ',')
+		{
+			items.push_back(item);
+			item.clear();
+		}
+		else
+		{
+			item += c;
+		}
+	}
+	items.push_back(item);
+	return items;
+}
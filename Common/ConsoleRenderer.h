@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <unistd.h>
+#endif
+
+/**
+	Console renderer that only redraws the cells that changed since the previous frame.
+
+	The renderer remembers the glyphs it has put on screen. A frame compares the board against them and emits an ANSI
+	cursor move plus the new glyph for every changed cell, so the cost of a frame follows births and deaths instead of
+	board size. Short gaps between changed cells on a row are written out instead of jumping over them.
+	The whole frame is assembled into one buffer and written with one system call.
+
+	The first frame, a frame after invalidate and a frame with a different size or number of header lines clear the
+	screen and draw everything. Call invalidate whenever something else has written to the console.
+	On Windows consoles without virtual terminal support every frame is drawn in full from the top left corner.
+*/
+
+//glyph of a cell state, dying states of Generations rules fade out from % to : and stay : after that
+inline char cellGlyph(int state)
+{
+	static const char dying[] = "%*+=-:";
+	if (state <= 0)
+		return '.';
+	if (state == 1)
+		return '#';
+	return state - 2 < (int)sizeof(dying) - 1 ? dying[state - 2] : dying[sizeof(dying) - 2];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ConsoleRenderer
+{
+public:
+	ConsoleRenderer();
+
+	//draws header lines and board (# alive . dead, see cellGlyph), cells is width x height with rows stride apart
+	void render(const int *cells, int width, int height, int stride, const std::vector<std::string> &header);
+
+	//next frame is drawn in full
+	void invalidate() { m_valid = false; }
+
+	//bytes written by the last frame
+	size_t lastFrameBytes() const { return m_lastFrameBytes; }
+
+private:
+	//appends cursor move to 1 based terminal row and column
+	void moveTo(int row, int column);
+
+	//writes the buffer to stdout with one call
+	void flush();
+
+	std::string m_buffer;		//frame being assembled
+	std::vector<char> m_screen;	//glyphs on screen, width x height
+	int m_width;
+	int m_height;
+	int m_headerLines;
+	bool m_valid;				//m_screen matches what is on the console
+	bool m_ansi;				//console understands escape sequences
+	size_t m_lastFrameBytes;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline ConsoleRenderer::ConsoleRenderer() : m_width(0), m_height(0), m_headerLines(0), m_valid(false), m_ansi(true), m_lastFrameBytes(0)
+{
+#ifdef _WIN32
+	//escape sequences have to be switched on for the windows console
+	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode = 0;
+	m_ansi = hOut != INVALID_HANDLE_VALUE && GetConsoleMode(hOut, &mode) && SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ConsoleRenderer::moveTo(int row, int column)
+{
+	char move[32];
+	snprintf(move, sizeof(move), "\x1b[%d;%dH", row, column);
+	m_buffer += move;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ConsoleRenderer::render(const int *cells, int width, int height, int stride, const std::vector<std::string> &header)
+{
+	const int MAX_GAP = 6; //unchanged cells shorter than a cursor move are written out
+
+	m_buffer.clear();
+	bool full = !m_valid || !m_ansi || width != m_width || height != m_height || (int)header.size() != m_headerLines;
+	if (full)
+	{
+		m_width = width;
+		m_height = height;
+		m_headerLines = (int)header.size();
+		m_screen.assign((size_t)width * height, ' ');
+	}
+
+	//header is short, it is always rewritten
+	if (m_ansi)
+	{
+		m_buffer += full ? "\x1b[H\x1b[2J" : "\x1b[H";
+	}
+	else
+	{
+#ifdef _WIN32
+		COORD home = { 0, 0 };
+		SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), home);
+#endif
+	}
+	for (const std::string &line : header)
+	{
+		m_buffer += line;
+		m_buffer += m_ansi ? "\x1b[K\n" : "\n"; //clear rest of the old line
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		const int *row = cells + (size_t)y * stride;
+		char *screen = &m_screen[(size_t)y * width];
+		if (full)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				screen[x] = cellGlyph(row[x]);
+			}
+			m_buffer.append(screen, width);
+			m_buffer += '\n';
+			continue;
+		}
+
+		int cursor = -1; //column after the last glyph written on this row, -1 when cursor is elsewhere
+		for (int x = 0; x < width; x++)
+		{
+			char glyph = cellGlyph(row[x]);
+			if (glyph == screen[x])
+			{
+				continue;
+			}
+
+			if (cursor >= 0 && x - cursor <= MAX_GAP)
+			{
+				m_buffer.append(screen + cursor, x - cursor); //cheaper than a cursor move
+			}
+			else
+			{
+				moveTo(m_headerLines + y + 1, x + 1);
+			}
+			screen[x] = glyph;
+			m_buffer += glyph;
+			cursor = x + 1;
+		}
+	}
+
+	if (!full) //leave the cursor below the board
+	{
+		moveTo(m_headerLines + height + 1, 1);
+	}
+	m_valid = true;
+	flush();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ConsoleRenderer::flush()
+{
+	std::cout.flush(); //earlier text must not end up after the frame
+	m_lastFrameBytes = m_buffer.size();
+
+#ifdef _WIN32
+	DWORD written = 0;
+	WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), m_buffer.data(), (DWORD)m_buffer.size(), &written, nullptr);
+#else
+	const char *data = m_buffer.data();
+	size_t left = m_buffer.size();
+	while (left > 0) //a pipe can take less than everything at once
+	{
+		ssize_t written = write(STDOUT_FILENO, data, left);
+		if (written <= 0)
+		{
+			break;
+		}
+		data += written;
+		left -= written;
+	}
+#endif
+}
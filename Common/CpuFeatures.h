@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+	Runtime detection of the vector instruction sets the simd kernels can use and of the cache size.
+	Kernels for a newer instruction set are compiled with GOL_TARGET_* so one binary runs on every x86 host,
+	the best supported kernel is picked at startup.
+*/
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GOL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+//msvc allows intrinsics of any instruction set in any function, gcc and clang need them enabled per function
+#if defined(GOL_X86) && !defined(_MSC_VER)
+#define GOL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define GOL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GOL_TARGET_SSE41
+#define GOL_TARGET_AVX2
+#endif
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE41,
+	AVX2
+};
+
+inline const char *simdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::AVX2:
+		return "avx2";
+	case SimdLevel::SSE41:
+		return "sse4.1";
+	default:
+		return "scalar";
+	}
+}
+
+//Asks the cpu (and on msvc the os for avx state saving) which instruction sets can be used
+inline SimdLevel querySimdLevel()
+{
+#if !defined(GOL_X86)
+	return SimdLevel::Scalar;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && avx && osxsave && (_xgetbv(0) & 6) == 6) //os saves xmm and ymm registers
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2)
+		return SimdLevel::AVX2;
+	if (sse41)
+		return SimdLevel::SSE41;
+	return SimdLevel::Scalar;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return SimdLevel::SSE41;
+	return SimdLevel::Scalar;
+#endif
+}
+
+//Best supported level, cpu is asked only once
+inline SimdLevel detectSimdLevel()
+{
+	static const SimdLevel level = querySimdLevel();
+	return level;
+}
+
+//L2 cache size of a core in bytes as the cpu reports it (extended leaf 0x80000006 on Intel and AMD), 0 when unknown
+inline long long queryL2CacheBytes()
+{
+#if !defined(GOL_X86)
+	return 0;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0x80000000);
+	if ((unsigned int)info[0] < 0x80000006)
+	{
+		return 0;
+	}
+	__cpuid(info, 0x80000006);
+	return (long long)(((unsigned int)info[2] >> 16) & 0xFFFF) * 1024;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(0x80000006, &eax, &ebx, &ecx, &edx))
+	{
+		return 0;
+	}
+	return (long long)((ecx >> 16) & 0xFFFF) * 1024;
+#endif
+}
+
+//L2 cache size in bytes, 256 KB when the cpu doesn't tell, cpu is asked only once
+inline long long detectL2CacheBytes()
+{
+	static const long long bytes = queryL2CacheBytes() > 0 ? queryL2CacheBytes() : 256 * 1024;
+	return bytes;
+}
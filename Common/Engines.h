@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "LifeEngine.h"
+#include "ReferenceBoard.h"
+#include "BitBoard.h"
+#include "ByteBoard.h"
+#include "TiledBoard.h"
+#include "GenerationsBoard.h"
+#include "InfiniteBoard.h"
+#include "HugeBoard.h"
+#include "TemporalBoard.h"
+#include "LookupBoard.h"
+
+/**
+	List of available simulation engines, every one a LifeEngine that GameOfLife creates through createEngine.
+	'reference' is the original int loop of GameOfLife::onUpdate, the others are compared against it.
+*/
+
+enum class EngineType
+{
+	Reference,	//int per cell loop, the original GameOfLife::onUpdate
+	BitPacked,	//64 cells per word, bit-parallel adders
+	Simd,		//byte per cell, avx2 / sse4.1 / scalar kernel picked at startup
+	Tiled,		//bitpacked in 64x64 tiles, only tiles near last generations changes are computed
+	Generations,	//byte per cell with decay states, runs Generations rules like B2/S/C3
+	Infinite,	//hash map of 64x64 chunks on an unbounded plane, the board is a window onto it
+	Huge,		//64x64 tiles in lazily committed memory, 64-bit indices, boards up to 1M x 1M
+	Temporal,	//bitpacked, several generations per pass over bands of rows that stay in cache
+	Lookup		//bitpacked, 2x2 blocks from a table of every 4x4 neighbourhood
+};
+
+struct EngineInfo
+{
+	EngineType type;
+	const char *name;
+};
+
+inline const EngineInfo g_engines[] =
+{
+	{ EngineType::Reference, "reference" },
+	{ EngineType::BitPacked, "bitpacked" },
+	{ EngineType::Simd, "simd" },
+	{ EngineType::Tiled, "tiled" },
+	{ EngineType::Generations, "generations" },
+	{ EngineType::Infinite, "infinite" },
+	{ EngineType::Huge, "huge" },
+	{ EngineType::Temporal, "temporal" },
+	{ EngineType::Lookup, "lookup" },
+};
+
+//returns the name of the engine type
+inline const char *engineName(EngineType type)
+{
+	for (const EngineInfo &info : g_engines)
+	{
+		if (info.type == type)
+			return info.name;
+	}
+	return "unknown";
+}
+
+//converts name into engine type, returns false when there is no such engine
+inline bool parseEngine(const std::string &s, EngineType &type)
+{
+	for (const EngineInfo &info : g_engines)
+	{
+		if (s == info.name)
+		{
+			type = info.type;
+			return true;
+		}
+	}
+	return false;
+}
+
+//comma separated list of engine names for prompts
+inline std::string engineList()
+{
+	std::string list;
+	for (const EngineInfo &info : g_engines)
+	{
+		if (!list.empty())
+			list += ", ";
+		list += info.name;
+	}
+	return list;
+}
+
+//creates the engine of type
+inline std::unique_ptr<LifeEngine> createEngine(EngineType type)
+{
+	switch (type)
+	{
+	case EngineType::Reference:
+		return std::unique_ptr<LifeEngine>(new ReferenceEngine());
+	case EngineType::BitPacked:
+		return std::unique_ptr<LifeEngine>(new BitBoardEngine());
+	case EngineType::Simd:
+		return std::unique_ptr<LifeEngine>(new ByteBoardEngine());
+	case EngineType::Tiled:
+		return std::unique_ptr<LifeEngine>(new TiledEngine());
+	case EngineType::Generations:
+		return std::unique_ptr<LifeEngine>(new GenerationsEngine());
+	case EngineType::Infinite:
+		return std::unique_ptr<LifeEngine>(new InfiniteEngine());
+	case EngineType::Huge:
+		return std::unique_ptr<LifeEngine>(new HugeEngine());
+	case EngineType::Temporal:
+		return std::unique_ptr<LifeEngine>(new TemporalEngine());
+	case EngineType::Lookup:
+		return std::unique_ptr<LifeEngine>(new LookupEngine());
+	default:
+		return nullptr;
+	}
+}
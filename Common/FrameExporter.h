@@ -0,0 +1,490 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PhaseTimer.h"
+
+/**
+	Writes the board as gray images every N generations on a background thread.
+
+	Formats, picked by the extension of the path:
+		.pgm	one binary PGM (P5) per frame
+		.png	one 8-bit gray PNG per frame, stored deflate blocks, no zlib needed (larger files, hardly any cpu)
+		.raw	every frame appended to one file as width x height bytes, a named pipe can feed it to an encoder,
+				for example ffmpeg -f rawvideo -pix_fmt gray -s WxH -i pipe
+	Image files are named after the path with the run of '#' replaced by the zero padded generation, without a '#'
+	the generation is put in front of the extension: frames/life_######.png gives frames/life_000120.png.
+
+	A pixel is a block of scale x scale cells, its gray is the share of alive cells in the block (255 all alive), so
+	a 16384 board at scale 16 is a 1024 image. The simulation thread only sums the blocks into a frame buffer, encoding
+	and writing is done by the writer thread. Frame buffers are a fixed pool of queueFrames, when all of them wait for
+	the writer the policy decides: Drop skips the frame and counts it, Wait holds the simulation until the writer has
+	caught up, which throttles it to the speed of the disk.
+*/
+
+enum class FrameFormat
+{
+	Pgm,
+	Png,
+	Raw
+};
+
+enum class FramePolicy
+{
+	Drop,	//skip frames while the writer is behind
+	Wait	//simulation waits for the writer
+};
+
+struct FrameOptions
+{
+	std::string path;
+	long long every = 1;		//generations between frames
+	int scale = 1;				//cells per pixel side
+	int queueFrames = 8;		//frames waiting for the writer at most
+	FramePolicy policy = FramePolicy::Drop;
+};
+
+//converts drop or wait into policy, returns false for anything else
+inline bool parseFramePolicy(const std::string &s, FramePolicy &policy)
+{
+	if (s == "drop")
+		policy = FramePolicy::Drop;
+	else if (s == "wait")
+		policy = FramePolicy::Wait;
+	else
+		return false;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class FrameExporter
+{
+public:
+	FrameExporter() : m_format(FrameFormat::Pgm), m_boardWidth(0), m_boardHeight(0), m_width(0), m_height(0), m_file(nullptr),
+		m_stop(false), m_failed(false), m_framesWritten(0), m_framesDropped(0), m_bytesWritten(0) {}
+	~FrameExporter() { stop(); }
+
+	FrameExporter(const FrameExporter &) = delete;
+	FrameExporter &operator=(const FrameExporter &) = delete;
+
+	//checks options for a board of boardWidth x boardHeight cells and starts the writer thread,
+	//returns false with a message in error when it can't
+	bool start(const FrameOptions &options, int boardWidth, int boardHeight, std::string &error);
+
+	//writes the frames still waiting and joins the writer, returns false when anything could not be written
+	bool stop();
+
+	bool isRunning() const { return m_thread.joinable(); }
+
+	//true when generation is one of the exported ones
+	bool wantsFrame(long long generation) const { return isRunning() && generation % m_options.every == 0; }
+
+	//queues the int board (1 alive) of generation, returns false when the frame was dropped
+	bool submit(long long generation, const int *cells, int stride);
+
+	int imageWidth() const { return m_width; }
+	int imageHeight() const { return m_height; }
+	FrameFormat format() const { return m_format; }
+	long long framesWritten() const { return m_framesWritten; }
+	long long framesDropped() const { return m_framesDropped; }
+	long long bytesWritten() const { return m_bytesWritten; }
+
+private:
+	struct Frame
+	{
+		long long generation = 0;
+		std::vector<uint8_t> pixels;	//imageWidth x imageHeight
+	};
+
+	void writerLoop();
+
+	//encodes frame into m_encoded and writes it, returns false on a write error
+	bool writeFrame(const Frame &frame);
+
+	//image file name of generation
+	std::string framePath(long long generation) const;
+
+	void encodePgm(const Frame &frame);
+	void encodePng(const Frame &frame);
+
+	FrameOptions m_options;
+	FrameFormat m_format;
+	int m_boardWidth;
+	int m_boardHeight;
+	int m_width;						//image size
+	int m_height;
+	FILE *m_file;						//raw stream, nullptr for image files
+	std::vector<Frame> m_frames;		//the pool of frame buffers
+	std::vector<int> m_free;			//frames the simulation may fill
+	std::deque<int> m_ready;			//frames waiting for the writer, oldest first
+	std::vector<uint8_t> m_encoded;		//file contents of a frame, writer thread only
+	std::vector<uint8_t> m_scanlines;	//png rows with their filter bytes, writer thread only
+	std::mutex m_mutex;
+	std::condition_variable m_readyChanged;	//frame queued or stop
+	std::condition_variable m_freeChanged;	//frame written
+	std::thread m_thread;
+	bool m_stop;
+	bool m_failed;
+	std::atomic<long long> m_framesWritten;
+	std::atomic<long long> m_framesDropped;
+	std::atomic<long long> m_bytesWritten;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool FrameExporter::start(const FrameOptions &options, int boardWidth, int boardHeight, std::string &error)
+{
+	stop();
+	const std::string &path = options.path;
+	auto endsWith = [&](const char *extension) { size_t n = strlen(extension); return path.size() > n && path.compare(path.size() - n, n, extension) == 0; };
+	if (endsWith(".pgm"))
+		m_format = FrameFormat::Pgm;
+	else if (endsWith(".png"))
+		m_format = FrameFormat::Png;
+	else if (endsWith(".raw"))
+		m_format = FrameFormat::Raw;
+	else
+	{
+		error = "frame file " + path + " must end in .pgm, .png or .raw";
+		return false;
+	}
+	if (options.every < 1 || options.scale < 1 || options.queueFrames < 1)
+	{
+		error = "frame interval, scale and queue must be at least 1";
+		return false;
+	}
+
+	m_options = options;
+	m_boardWidth = boardWidth;
+	m_boardHeight = boardHeight;
+	m_width = (boardWidth + options.scale - 1) / options.scale;
+	m_height = (boardHeight + options.scale - 1) / options.scale;
+	if (m_format == FrameFormat::Raw)
+	{
+#ifdef _MSC_VER
+		fopen_s(&m_file, path.c_str(), "wb");
+#else
+		m_file = fopen(path.c_str(), "wb");
+#endif
+		if (!m_file)
+		{
+			error = "can't create " + path;
+			return false;
+		}
+	}
+
+	m_frames.assign(options.queueFrames, Frame());
+	m_free.clear();
+	m_ready.clear();
+	for (int i = options.queueFrames - 1; i >= 0; i--)
+	{
+		m_frames[i].pixels.resize((size_t)m_width * m_height);
+		m_free.push_back(i);
+	}
+	m_stop = false;
+	m_failed = false;
+	m_framesWritten = 0;
+	m_framesDropped = 0;
+	m_bytesWritten = 0;
+	m_thread = std::thread(&FrameExporter::writerLoop, this);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool FrameExporter::stop()
+{
+	if (!m_thread.joinable())
+	{
+		return !m_failed;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_readyChanged.notify_one();
+	m_thread.join();
+	if (m_file)
+	{
+		m_failed |= fclose(m_file) != 0;
+		m_file = nullptr;
+	}
+	m_frames = std::vector<Frame>();
+	return !m_failed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool FrameExporter::submit(long long generation, const int *cells, int stride)
+{
+	int slot;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_free.empty() && m_options.policy == FramePolicy::Drop)
+		{
+			m_framesDropped++;
+			return false;
+		}
+		m_freeChanged.wait(lock, [this] { return !m_free.empty(); });
+		slot = m_free.back();
+		m_free.pop_back();
+	}
+
+	//blocks of scale x scale cells, the last row and column of blocks may be cut by the board edge
+	Frame &frame = m_frames[slot];
+	frame.generation = generation;
+	int scale = m_options.scale;
+	for (int py = 0; py < m_height; py++)
+	{
+		uint8_t *pixels = &frame.pixels[(size_t)py * m_width];
+		if (scale == 1)
+		{
+			const int *row = cells + (size_t)py * stride;
+			for (int x = 0; x < m_width; x++)
+			{
+				pixels[x] = row[x] == 1 ? 255 : 0;
+			}
+			continue;
+		}
+		int top = py * scale;
+		int bottom = (std::min)(top + scale, m_boardHeight);
+		for (int px = 0; px < m_width; px++)
+		{
+			int left = px * scale;
+			int right = (std::min)(left + scale, m_boardWidth);
+			int count = 0;
+			for (int y = top; y < bottom; y++)
+			{
+				const int *row = cells + (size_t)y * stride;
+				for (int x = left; x < right; x++)
+				{
+					count += row[x] == 1;
+				}
+			}
+			int area = (bottom - top) * (right - left);
+			pixels[px] = (uint8_t)((count * 255 + area / 2) / area);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_ready.push_back(slot);
+	}
+	m_readyChanged.notify_one();
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void FrameExporter::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_readyChanged.wait(lock, [this] { return m_stop || !m_ready.empty(); });
+		if (m_ready.empty()) //stopped and every frame is written
+		{
+			return;
+		}
+		int slot = m_ready.front();
+		m_ready.pop_front();
+		lock.unlock();
+
+		bool written;
+		{
+			PhaseScope phase(Phase::Export);
+			written = writeFrame(m_frames[slot]);
+		}
+
+		lock.lock();
+		m_failed |= !written;
+		m_free.push_back(slot);
+		m_freeChanged.notify_one();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool FrameExporter::writeFrame(const Frame &frame)
+{
+	if (m_format == FrameFormat::Raw)
+	{
+		size_t size = frame.pixels.size();
+		bool ok = fwrite(frame.pixels.data(), 1, size, m_file) == size;
+		m_bytesWritten += size;
+		m_framesWritten++;
+		return ok;
+	}
+
+	if (m_format == FrameFormat::Png)
+		encodePng(frame);
+	else
+		encodePgm(frame);
+
+	std::string path = framePath(frame.generation);
+	FILE *file = nullptr;
+#ifdef _MSC_VER
+	fopen_s(&file, path.c_str(), "wb");
+#else
+	file = fopen(path.c_str(), "wb");
+#endif
+	if (!file)
+	{
+		return false;
+	}
+	bool ok = fwrite(m_encoded.data(), 1, m_encoded.size(), file) == m_encoded.size();
+	ok = fclose(file) == 0 && ok;
+	m_bytesWritten += m_encoded.size();
+	m_framesWritten++;
+	return ok;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::string FrameExporter::framePath(long long generation) const
+{
+	const std::string &path = m_options.path;
+	std::string number = std::to_string(generation);
+	size_t first = path.find('#');
+	if (first == std::string::npos)
+	{
+		size_t dot = path.rfind('.');
+		return path.substr(0, dot) + "_" + std::string(number.size() < 6 ? 6 - number.size() : 0, '0') + number + path.substr(dot);
+	}
+	size_t last = path.find_first_not_of('#', first);
+	size_t digits = (last == std::string::npos ? path.size() : last) - first;
+	if (number.size() < digits)
+	{
+		number.insert(0, digits - number.size(), '0');
+	}
+	return path.substr(0, first) + number + (last == std::string::npos ? std::string() : path.substr(last));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void FrameExporter::encodePgm(const Frame &frame)
+{
+	char header[64];
+	int length = snprintf(header, sizeof(header), "P5\n%d %d\n255\n", m_width, m_height);
+	m_encoded.assign(header, header + length);
+	m_encoded.insert(m_encoded.end(), frame.pixels.begin(), frame.pixels.end());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//CRC-32 of PNG chunks, crc is the value of the data before
+inline uint32_t pngCrc(uint32_t crc, const uint8_t *data, size_t size)
+{
+	static const struct Table
+	{
+		uint32_t values[256];
+		Table()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				values[n] = c;
+			}
+		}
+	} table;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void FrameExporter::encodePng(const Frame &frame)
+{
+	std::vector<uint8_t> &out = m_encoded;
+	auto put32 = [&](uint32_t value)
+	{
+		uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+		out.insert(out.end(), bytes, bytes + 4);
+	};
+	//chunk is length, type, data and the crc of type and data, the length is patched in by endChunk
+	size_t chunkStart = 0;
+	auto beginChunk = [&](const char *type)
+	{
+		chunkStart = out.size();
+		put32(0);
+		out.insert(out.end(), type, type + 4);
+	};
+	auto endChunk = [&]()
+	{
+		uint32_t length = (uint32_t)(out.size() - chunkStart - 8);
+		for (int i = 0; i < 4; i++)
+		{
+			out[chunkStart + i] = (uint8_t)(length >> (24 - 8 * i));
+		}
+		put32(pngCrc(0, &out[chunkStart + 4], length + 4));
+	};
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.assign(signature, signature + 8);
+
+	beginChunk("IHDR");
+	put32((uint32_t)m_width);
+	put32((uint32_t)m_height);
+	const uint8_t format[5] = { 8, 0, 0, 0, 0 }; //8 bit gray, deflate, adaptive filters, no interlace
+	out.insert(out.end(), format, format + 5);
+	endChunk();
+
+	//zlib stream of stored blocks over the rows, each row starts with filter type 0
+	size_t rowBytes = (size_t)m_width + 1;
+	m_scanlines.resize(rowBytes * m_height);
+	for (int y = 0; y < m_height; y++)
+	{
+		m_scanlines[y * rowBytes] = 0;
+		memcpy(&m_scanlines[y * rowBytes + 1], &frame.pixels[(size_t)y * m_width], m_width);
+	}
+	uint32_t a = 1, b = 0; //adler-32, the sums can't overflow within 5552 bytes
+	for (size_t start = 0; start < m_scanlines.size(); start += 5552)
+	{
+		size_t end = std::min<size_t>(start + 5552, m_scanlines.size());
+		for (size_t i = start; i < end; i++)
+		{
+			a += m_scanlines[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+
+	beginChunk("IDAT");
+	out.push_back(0x78);
+	out.push_back(0x01);
+	size_t done = 0;
+	do
+	{
+		size_t block = std::min<size_t>(m_scanlines.size() - done, 65535);
+		bool final = done + block == m_scanlines.size();
+		const uint8_t header[5] = { (uint8_t)final, (uint8_t)block, (uint8_t)(block >> 8), (uint8_t)~block, (uint8_t)(~block >> 8) };
+		out.insert(out.end(), header, header + 5);
+		out.insert(out.end(), m_scanlines.begin() + done, m_scanlines.begin() + done + block);
+		done += block;
+	} while (done < m_scanlines.size());
+	put32((b << 16) | a);
+	endChunk();
+
+	beginChunk("IEND");
+	endChunk();
+}
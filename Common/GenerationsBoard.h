@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "LifeEngine.h"
+#include "CpuFeatures.h"
+#include "HaloGrid.h"
+#include "ByteBoard.h"
+
+/**
+	Byte per cell engine for Generations rules (see Rule.h), where dying cells pass through decay states.
+
+	Cells hold their state 0..states-1 in a HaloGrid of bytes. The kernels count only neighbours in state 1, so a
+	neighbour load is compared against 1 before it is added. The next state comes without branches:
+		dead:		birth table looked up by the count
+		alive:		1 when the survive table says so, otherwise the first dying state
+		dying:		state + 1, wrapping to dead after the last state
+	Alive and dying cells both step to state + 1 wrapped, so "alive and survives" is the only case that differs.
+	Two state rules run here as well and give the same boards as the simd engine.
+*/
+
+//Kernel for one row of a Generations board, same arguments as ByteRowKernel
+typedef void (*GenerationsRowKernel)(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats);
+
+//Scalar kernel for cells from..to-1 of a row, keeps a sliding window of alive counts per column
+inline void stepGenerationsCells(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int from, int to, uint64_t rowCell, StepStats &stats)
+{
+	auto alive = [](uint8_t state) { return (int)(state == 1); };
+
+	int left = alive(above[from - 1]) + alive(row[from - 1]) + alive(below[from - 1]);
+	int middle = alive(above[from]) + alive(row[from]) + alive(below[from]);
+	for (int x = from; x < to; x++)
+	{
+		int right = alive(above[x + 1]) + alive(row[x + 1]) + alive(below[x + 1]);
+		int nNeighbours = left + middle + right - alive(row[x]);
+
+		uint8_t state = (uint8_t)rule.nextState(row[x], nNeighbours);
+		out[x] = state;
+		stats.aliveCount += state == 1;
+		stats.survivors += (state == 1) & (row[x] == 1);
+		if (state != row[x])
+		{
+			stats.hashDelta ^= (row[x] ? zobristStateKey(rowCell + x, row[x]) : 0) ^ (state ? zobristStateKey(rowCell + x, state) : 0);
+		}
+
+		left = middle;
+		middle = right;
+	}
+}
+
+inline void stepGenerationsRowScalar(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	stepGenerationsCells(rule, above, row, below, out, 0, width, rowCell, stats);
+}
+
+//hash change of the cells flagged in changed (bit i is cell x + i)
+inline uint64_t generationsHashDelta(const uint8_t *row, const uint8_t *out, int x, uint32_t changed, uint64_t rowCell)
+{
+	uint64_t hash = 0;
+	while (changed)
+	{
+		int i = lowestBit64(changed);
+		uint64_t cell = rowCell + x + i;
+		hash ^= (row[x + i] ? zobristStateKey(cell, row[x + i]) : 0) ^ (out[x + i] ? zobristStateKey(cell, out[x + i]) : 0);
+		changed &= changed - 1;
+	}
+	return hash;
+}
+
+#ifdef GOL_X86
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//32 cells per instruction
+GOL_TARGET_AVX2 inline void stepGenerationsRowAVX2(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i states = _mm256_set1_epi8((char)rule.states); //256 states wraps to 0, which no state + 1 reaches
+	const __m256i birthTable = _mm256_broadcastsi128_si256(byteRuleTable(rule.birth));
+	const __m256i surviveTable = _mm256_broadcastsi128_si256(byteRuleTable(rule.survive));
+	__m256i aliveSum = zero;
+	__m256i survivorSum = zero;
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i aboveLeft = _mm256_loadu_si256((const __m256i *)(above + x - 1));
+		__m256i aboveMid = _mm256_loadu_si256((const __m256i *)(above + x));
+		__m256i aboveRight = _mm256_loadu_si256((const __m256i *)(above + x + 1));
+		__m256i rowLeft = _mm256_loadu_si256((const __m256i *)(row + x - 1));
+		__m256i self = _mm256_loadu_si256((const __m256i *)(row + x));
+		__m256i rowRight = _mm256_loadu_si256((const __m256i *)(row + x + 1));
+		__m256i belowLeft = _mm256_loadu_si256((const __m256i *)(below + x - 1));
+		__m256i belowMid = _mm256_loadu_si256((const __m256i *)(below + x));
+		__m256i belowRight = _mm256_loadu_si256((const __m256i *)(below + x + 1));
+
+		//nothing alive or dying around these cells, they all stay dead
+		__m256i any = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(aboveLeft, aboveMid), _mm256_or_si256(aboveRight, rowLeft)),
+									  _mm256_or_si256(_mm256_or_si256(self, rowRight), _mm256_or_si256(_mm256_or_si256(belowLeft, belowMid), belowRight)));
+		if (_mm256_testz_si256(any, any))
+		{
+			_mm256_storeu_si256((__m256i *)(out + x), zero);
+			continue;
+		}
+
+		//0xFF for neighbours in state 1, the sum of the eight masks is minus the count
+		__m256i negative = _mm256_add_epi8(_mm256_add_epi8(_mm256_add_epi8(_mm256_cmpeq_epi8(aboveLeft, one), _mm256_cmpeq_epi8(aboveMid, one)), _mm256_add_epi8(_mm256_cmpeq_epi8(aboveRight, one), _mm256_cmpeq_epi8(rowLeft, one))),
+										   _mm256_add_epi8(_mm256_add_epi8(_mm256_cmpeq_epi8(rowRight, one), _mm256_cmpeq_epi8(belowLeft, one)), _mm256_add_epi8(_mm256_cmpeq_epi8(belowMid, one), _mm256_cmpeq_epi8(belowRight, one))));
+		__m256i nNeighbours = _mm256_sub_epi8(zero, negative);
+
+		__m256i isDead = _mm256_cmpeq_epi8(self, zero);
+		__m256i isAlive = _mm256_cmpeq_epi8(self, one);
+		__m256i born = _mm256_shuffle_epi8(birthTable, nNeighbours);
+		__m256i stays = _mm256_and_si256(isAlive, _mm256_cmpeq_epi8(_mm256_shuffle_epi8(surviveTable, nNeighbours), one));
+		__m256i older = _mm256_add_epi8(self, one);
+		older = _mm256_andnot_si256(_mm256_cmpeq_epi8(older, states), older); //past the last state is dead
+		__m256i next = _mm256_blendv_epi8(_mm256_blendv_epi8(older, one, stays), born, isDead);
+		_mm256_storeu_si256((__m256i *)(out + x), next);
+
+		__m256i nextAlive = _mm256_and_si256(_mm256_cmpeq_epi8(next, one), one);
+		aliveSum = _mm256_add_epi64(aliveSum, _mm256_sad_epu8(nextAlive, zero));
+		survivorSum = _mm256_add_epi64(survivorSum, _mm256_sad_epu8(_mm256_and_si256(nextAlive, self), zero));
+
+		uint32_t changed = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, self));
+		if (changed)
+		{
+			stats.hashDelta ^= generationsHashDelta(row, out, x, changed, rowCell);
+		}
+	}
+
+	alignas(32) uint64_t lanes[4];
+	_mm256_store_si256((__m256i *)lanes, aliveSum);
+	stats.aliveCount += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm256_store_si256((__m256i *)lanes, survivorSum);
+	stats.survivors += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	stepGenerationsCells(rule, above, row, below, out, x, width, rowCell, stats);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//16 cells per instruction
+GOL_TARGET_SSE41 inline void stepGenerationsRowSSE41(const Rule &rule, const uint8_t *above, const uint8_t *row, const uint8_t *below, uint8_t *out, int width, uint64_t rowCell, StepStats &stats)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i states = _mm_set1_epi8((char)rule.states);
+	const __m128i birthTable = byteRuleTable(rule.birth);
+	const __m128i surviveTable = byteRuleTable(rule.survive);
+	__m128i aliveSum = zero;
+	__m128i survivorSum = zero;
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i aboveLeft = _mm_loadu_si128((const __m128i *)(above + x - 1));
+		__m128i aboveMid = _mm_loadu_si128((const __m128i *)(above + x));
+		__m128i aboveRight = _mm_loadu_si128((const __m128i *)(above + x + 1));
+		__m128i rowLeft = _mm_loadu_si128((const __m128i *)(row + x - 1));
+		__m128i self = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i rowRight = _mm_loadu_si128((const __m128i *)(row + x + 1));
+		__m128i belowLeft = _mm_loadu_si128((const __m128i *)(below + x - 1));
+		__m128i belowMid = _mm_loadu_si128((const __m128i *)(below + x));
+		__m128i belowRight = _mm_loadu_si128((const __m128i *)(below + x + 1));
+
+		//nothing alive or dying around these cells, they all stay dead
+		__m128i any = _mm_or_si128(_mm_or_si128(_mm_or_si128(aboveLeft, aboveMid), _mm_or_si128(aboveRight, rowLeft)),
+								   _mm_or_si128(_mm_or_si128(self, rowRight), _mm_or_si128(_mm_or_si128(belowLeft, belowMid), belowRight)));
+		if (_mm_testz_si128(any, any))
+		{
+			_mm_storeu_si128((__m128i *)(out + x), zero);
+			continue;
+		}
+
+		//0xFF for neighbours in state 1, the sum of the eight masks is minus the count
+		__m128i negative = _mm_add_epi8(_mm_add_epi8(_mm_add_epi8(_mm_cmpeq_epi8(aboveLeft, one), _mm_cmpeq_epi8(aboveMid, one)), _mm_add_epi8(_mm_cmpeq_epi8(aboveRight, one), _mm_cmpeq_epi8(rowLeft, one))),
+										_mm_add_epi8(_mm_add_epi8(_mm_cmpeq_epi8(rowRight, one), _mm_cmpeq_epi8(belowLeft, one)), _mm_add_epi8(_mm_cmpeq_epi8(belowMid, one), _mm_cmpeq_epi8(belowRight, one))));
+		__m128i nNeighbours = _mm_sub_epi8(zero, negative);
+
+		__m128i isDead = _mm_cmpeq_epi8(self, zero);
+		__m128i isAlive = _mm_cmpeq_epi8(self, one);
+		__m128i born = _mm_shuffle_epi8(birthTable, nNeighbours);
+		__m128i stays = _mm_and_si128(isAlive, _mm_cmpeq_epi8(_mm_shuffle_epi8(surviveTable, nNeighbours), one));
+		__m128i older = _mm_add_epi8(self, one);
+		older = _mm_andnot_si128(_mm_cmpeq_epi8(older, states), older);
+		__m128i next = _mm_blendv_epi8(_mm_blendv_epi8(older, one, stays), born, isDead);
+		_mm_storeu_si128((__m128i *)(out + x), next);
+
+		__m128i nextAlive = _mm_and_si128(_mm_cmpeq_epi8(next, one), one);
+		aliveSum = _mm_add_epi64(aliveSum, _mm_sad_epu8(nextAlive, zero));
+		survivorSum = _mm_add_epi64(survivorSum, _mm_sad_epu8(_mm_and_si128(nextAlive, self), zero));
+
+		uint32_t changed = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(next, self)) & 0xFFFF;
+		if (changed)
+		{
+			stats.hashDelta ^= generationsHashDelta(row, out, x, changed, rowCell);
+		}
+	}
+
+	alignas(16) uint64_t lanes[2];
+	_mm_store_si128((__m128i *)lanes, aliveSum);
+	stats.aliveCount += lanes[0] + lanes[1];
+	_mm_store_si128((__m128i *)lanes, survivorSum);
+	stats.survivors += lanes[0] + lanes[1];
+
+	stepGenerationsCells(rule, above, row, below, out, x, width, rowCell, stats);
+}
+
+#endif // GOL_X86
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns the row kernel for the level, levels the build can't run fall back to scalar
+inline GenerationsRowKernel generationsRowKernel(SimdLevel level)
+{
+#ifdef GOL_X86
+	switch (level)
+	{
+	case SimdLevel::AVX2:
+		return stepGenerationsRowAVX2;
+	case SimdLevel::SSE41:
+		return stepGenerationsRowSSE41;
+	default:
+		break;
+	}
+#endif
+	return stepGenerationsRowScalar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Engine running multi-state boards with the best kernel the cpu supports
+class GenerationsEngine : public LifeEngine
+{
+public:
+	//level can be lowered to compare kernels, it is never raised above what the cpu supports
+	explicit GenerationsEngine(SimdLevel level = detectSimdLevel());
+
+	const char *name() const override { return "generations"; }
+	std::string describe() const override { return std::string("generations (") + simdLevelName(m_level) + " kernel, " + std::to_string(m_rule.states) + " states)"; }
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setBoundary(Boundary boundary) override { m_grid.setBoundary(boundary); return boundary != Boundary::Infinite; }
+	bool setRule(const Rule &rule) override { m_rule = rule; return true; }
+
+private:
+	SimdLevel m_level;
+	GenerationsRowKernel m_kernel;
+	HaloGrid<uint8_t> m_grid;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline GenerationsEngine::GenerationsEngine(SimdLevel level)
+{
+	m_level = ((int)level > (int)detectSimdLevel()) ? detectSimdLevel() : level;
+	m_kernel = generationsRowKernel(m_level);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void GenerationsEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_grid.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		uint8_t *row = m_grid.row(y);
+		for (int x = 0; x < width; x++)
+		{
+			int state = cells[y * stride + x];
+			row[x] = (uint8_t)(state > 0 && state < m_rule.states ? state : 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void GenerationsEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_grid.height(); y++)
+	{
+		const uint8_t *row = m_grid.row(y);
+		for (int x = 0; x < m_grid.width(); x++)
+		{
+			cells[y * stride + x] = row[x];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats GenerationsEngine::step()
+{
+	m_grid.fillHalo();
+	StepStats stats = forEachBand(m_grid.height(), [&](int firstRow, int lastRow, StepStats &bandStats)
+	{
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			long long alive = bandStats.aliveCount;
+			m_kernel(m_rule, m_grid.row(y - 1), m_grid.row(y), m_grid.row(y + 1), m_grid.nextRow(y), m_grid.width(), (uint64_t)y * m_grid.width(), bandStats);
+			if (bandStats.aliveCount != alive)
+			{
+				addRowBounds(m_grid.nextRow(y), m_grid.width(), y, bandStats.bounds);
+			}
+		}
+	});
+	m_grid.swap();
+	return stats;
+}
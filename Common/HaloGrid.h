@@ -0,0 +1,188 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+	Two generation grid with a one cell ghost border (halo) around the board.
+
+	Every row has a ghost cell at x = -1 and x = width and there are ghost rows at y = -1 and y = height, so a kernel can
+	read all eight neighbours of any board cell without bounds checks. fillHalo writes the ghost cells of the current
+	generation from the board according to the boundary mode. The current and next generation are two buffers that
+	swap by pointer, nothing is copied between generations.
+*/
+
+//What lies beyond the edge of the board
+enum class Boundary
+{
+	Dead,	//cells outside are dead
+	Torus,	//left edge continues on the right edge and top on the bottom
+	Mirror,	//cells outside are reflections of the edge cells
+	Infinite	//board is a window onto an unbounded plane, cells outside live on (InfiniteEngine only)
+};
+
+inline const char *boundaryName(Boundary boundary)
+{
+	switch (boundary)
+	{
+	case Boundary::Torus:
+		return "torus";
+	case Boundary::Mirror:
+		return "mirror";
+	case Boundary::Infinite:
+		return "infinite";
+	default:
+		return "dead";
+	}
+}
+
+//converts name into boundary mode, returns false when there is no such mode
+inline bool parseBoundary(const std::string &s, Boundary &boundary)
+{
+	const Boundary modes[] = { Boundary::Dead, Boundary::Torus, Boundary::Mirror, Boundary::Infinite };
+	for (Boundary mode : modes)
+	{
+		if (s == boundaryName(mode))
+		{
+			boundary = mode;
+			return true;
+		}
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Cell>
+class HaloGrid
+{
+public:
+	HaloGrid() : m_width(0), m_height(0), m_stride(2), m_boundary(Boundary::Dead), m_current(nullptr), m_next(nullptr) {}
+	HaloGrid(int width, int height, Boundary boundary = Boundary::Dead) : HaloGrid() { m_boundary = boundary; resize(width, height); }
+
+	//buffers are referenced by pointer, copying would share them
+	HaloGrid(const HaloGrid &) = delete;
+	HaloGrid &operator=(const HaloGrid &) = delete;
+
+	//resizes both generations, all cells dead
+	void resize(int width, int height);
+
+	void setBoundary(Boundary boundary) { m_boundary = boundary; }
+	Boundary boundary() const { return m_boundary; }
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	//distance between rows in cells
+	int stride() const { return m_stride; }
+
+	//pointer to cell x = 0 of current generation row y, valid for y = -1..height and x = -1..width
+	Cell *row(int y) { return m_current + (size_t)(y + 1) * m_stride + 1; }
+	const Cell *row(int y) const { return m_current + (size_t)(y + 1) * m_stride + 1; }
+
+	//pointer to cell x = 0 of next generation row y
+	Cell *nextRow(int y) { return m_next + (size_t)(y + 1) * m_stride + 1; }
+
+	Cell &at(int x, int y) { return row(y)[x]; }
+	const Cell &at(int x, int y) const { return row(y)[x]; }
+
+	//writes the ghost cells of the current generation for the boundary mode
+	void fillHalo();
+
+	//next generation becomes current
+	void swap() { std::swap(m_current, m_next); }
+
+	//sets every cell of the current generation dead
+	void clear();
+
+private:
+	int m_width;
+	int m_height;
+	int m_stride;				//width plus two ghost cells
+	Boundary m_boundary;
+	std::vector<Cell> m_cells;	//both generations, one after another
+	Cell *m_current;
+	Cell *m_next;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Cell>
+void HaloGrid<Cell>::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_stride = width + 2;
+
+	size_t bufferSize = (size_t)m_stride * (height + 2);
+	m_cells.assign(bufferSize * 2, Cell());
+	m_current = m_cells.data();
+	m_next = m_cells.data() + bufferSize;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Cell>
+void HaloGrid<Cell>::fillHalo()
+{
+	if (m_width == 0 || m_height == 0)
+	{
+		return;
+	}
+
+	//ghost columns
+	for (int y = 0; y < m_height; y++)
+	{
+		Cell *cells = row(y);
+		switch (m_boundary)
+		{
+		case Boundary::Torus:
+			cells[-1] = cells[m_width - 1];
+			cells[m_width] = cells[0];
+			break;
+		case Boundary::Mirror:
+			cells[-1] = cells[0];
+			cells[m_width] = cells[m_width - 1];
+			break;
+		default:
+			cells[-1] = Cell();
+			cells[m_width] = Cell();
+			break;
+		}
+	}
+
+	//ghost rows, copied with their ghost columns so the corners are right too
+	Cell *top = row(-1) - 1;
+	Cell *bottom = row(m_height) - 1;
+	for (int x = 0; x < m_stride; x++)
+	{
+		switch (m_boundary)
+		{
+		case Boundary::Torus:
+			top[x] = (row(m_height - 1) - 1)[x];
+			bottom[x] = (row(0) - 1)[x];
+			break;
+		case Boundary::Mirror:
+			top[x] = (row(0) - 1)[x];
+			bottom[x] = (row(m_height - 1) - 1)[x];
+			break;
+		default:
+			top[x] = Cell();
+			bottom[x] = Cell();
+			break;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Cell>
+void HaloGrid<Cell>::clear()
+{
+	size_t bufferSize = (size_t)m_stride * (m_height + 2);
+	for (size_t i = 0; i < bufferSize; i++)
+	{
+		m_current[i] = Cell();
+	}
+}
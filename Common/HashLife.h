@@ -0,0 +1,670 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Rule.h"
+
+/**
+	HashLife: the plane is a quadtree of hash-consed nodes, identical squares anywhere on the plane and at any time
+	are the same node. Every node of level L (2^L x 2^L cells) remembers its centre square 2^(L-2) generations ahead,
+	so repeating patterns and empty space are computed only once and large jumps cost about as much as small ones.
+
+	The plane is unbounded: unlike the fixed boards of GameOfLife nothing dies at the board edge. When the result is
+	stored back into a board, cells outside of it are clipped.
+
+	Nodes live in one array and are referenced by index. The node cache is bounded by maxNodes: after every advance
+	the cache is garbage collected when it is above the bound. Nodes not reachable from the current root are freed
+	and remembered results pointing at freed nodes are forgotten. A single advance may go over the bound temporarily.
+*/
+
+class HashLife
+{
+public:
+	//maxNodes bounds the node cache, one node takes 32 bytes, the rule is built into the 4x4 base table
+	explicit HashLife(size_t maxNodes = 1 << 22, const Rule &rule = Rule());
+
+	//empties the plane and resets generation to 0
+	void clear();
+
+	//copies width x height int board (rows stride apart) into the plane, board cell x y is plane cell x y
+	void load(const int *cells, int width, int height, int stride);
+
+	//copies plane cells 0..width-1 x 0..height-1 into int board, everything outside is clipped
+	void store(int *cells, int width, int height, int stride) const;
+
+	void setCell(int64_t x, int64_t y, bool alive);
+	bool getCell(int64_t x, int64_t y) const;
+
+	//calls visit(x, y) for every alive cell of the plane, nothing is clipped
+	template<class Visit>
+	void forEachAlive(Visit visit) const;
+
+	//advances the plane by 2^k generations
+	void advancePow2(int k);
+
+	//advances the plane to generation, returns false if generation is already behind
+	bool advanceTo(uint64_t generation);
+
+	uint64_t generation() const { return m_generation; }
+	uint64_t population() const { return m_nodes[m_root].population; }
+
+	//nodes in the cache and the memory they take
+	size_t nodeCount() const { return m_nodes.size() - m_freeNodes.size(); }
+	size_t memoryUsage() const { return m_nodes.capacity() * sizeof(Node) + m_table.capacity() * sizeof(uint32_t); }
+
+	//frees nodes that are not part of the current plane
+	void collectGarbage();
+
+private:
+	static constexpr uint32_t NONE = 0xffffffff;
+	static constexpr uint32_t DEAD = 0;		//level 0 leaf
+	static constexpr uint32_t ALIVE = 1;	//level 0 leaf
+
+	struct Node
+	{
+		uint32_t nw, ne, sw, se;	//children, leaves have none
+		uint32_t result;			//remembered centre resultStep generations ahead, NONE when not known
+		int8_t level;				//node is 2^level cells wide, -1 for freed nodes
+		int8_t resultStep;			//result is 2^resultStep generations ahead
+		uint8_t mark;				//used by garbage collection
+		uint64_t population;
+	};
+
+	//returns the node with these children, creates it if it doesn't exist yet
+	uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+
+	//node of the level with no alive cells
+	uint32_t empty(int level);
+
+	//centre square (level - 1) of the node without advancing time
+	uint32_t centre(uint32_t n);
+
+	//centre square of the node 2^min(level - 2, m_step) generations ahead
+	uint32_t result(uint32_t n);
+
+	//result of a level 2 node, one generation from the lookup table
+	uint32_t baseResult(uint32_t n);
+
+	//wraps the root into a root of one level higher with the same centre
+	void expand();
+
+	//true when every alive cell is inside the middle quarter of the root
+	bool fitsInner() const;
+
+	uint32_t setCell(uint32_t n, int64_t x, int64_t y, bool alive);
+	uint32_t build(const int *cells, int width, int height, int stride, int level, int64_t left, int64_t top);
+	void extract(uint32_t n, int64_t left, int64_t top, int *cells, int width, int height, int stride) const;
+
+	template<class Visit>
+	void visitAlive(uint32_t n, int64_t left, int64_t top, Visit &visit) const;
+
+	uint64_t hashOf(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) const;
+	void insert(uint32_t n);
+	void rebuildTable(size_t size);
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_freeNodes;	//indices of freed nodes for reuse
+	std::vector<uint32_t> m_table;		//open addressing hash table of node indices
+	size_t m_tableCount;				//nodes in the table
+	std::vector<uint32_t> m_empty;		//empty node for each level
+	std::vector<uint8_t> m_baseTable;	//4x4 cells -> 2x2 centre one generation later
+	size_t m_maxNodes;
+	uint32_t m_root;
+	int m_step;							//log2 of the step advancePow2 is doing
+	uint64_t m_generation;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline HashLife::HashLife(size_t maxNodes, const Rule &rule)
+{
+	m_maxNodes = maxNodes;
+	m_baseTable.resize(65536);
+
+	//4x4 bitmap has cell x y in bit y * 4 + x, the 2x2 result has centre cell (1 + i, 1 + j) in bit j * 2 + i
+	for (int bits = 0; bits < 65536; bits++)
+	{
+		uint8_t out = 0;
+		for (int j = 0; j < 2; j++)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				int cx = 1 + i;
+				int cy = 1 + j;
+				int nNeighbours = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if (dx != 0 || dy != 0)
+						{
+							nNeighbours += (bits >> ((cy + dy) * 4 + cx + dx)) & 1;
+						}
+					}
+				}
+				bool alive = (bits >> (cy * 4 + cx)) & 1;
+				if (rule.next(alive, nNeighbours))
+				{
+					out |= 1 << (j * 2 + i);
+				}
+			}
+		}
+		m_baseTable[bits] = out;
+	}
+
+	clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::clear()
+{
+	m_nodes.clear();
+	m_freeNodes.clear();
+	m_empty.clear();
+
+	Node leaf = {};
+	leaf.result = NONE;
+	m_nodes.push_back(leaf); //DEAD
+	leaf.population = 1;
+	m_nodes.push_back(leaf); //ALIVE
+
+	rebuildTable(1024);
+	m_root = empty(3);
+	m_step = 0;
+	m_generation = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t HashLife::hashOf(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) const
+{
+	uint64_t h = (((uint64_t)nw << 32) | ne) * 0x9E3779B97F4A7C15ULL;
+	h ^= (((uint64_t)sw << 32) | se) * 0xC2B2AE3D27D4EB4FULL;
+	return h ^ (h >> 31);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::insert(uint32_t n)
+{
+	const Node &node = m_nodes[n];
+	size_t mask = m_table.size() - 1;
+	size_t slot = hashOf(node.nw, node.ne, node.sw, node.se) & mask;
+	while (m_table[slot] != NONE)
+	{
+		slot = (slot + 1) & mask;
+	}
+	m_table[slot] = n;
+	m_tableCount++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::rebuildTable(size_t size)
+{
+	m_table.assign(size, NONE);
+	m_tableCount = 0;
+	for (uint32_t n = ALIVE + 1; n < m_nodes.size(); n++)
+	{
+		if (m_nodes[n].level > 0)
+		{
+			insert(n);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+	size_t mask = m_table.size() - 1;
+	size_t slot = hashOf(nw, ne, sw, se) & mask;
+	while (m_table[slot] != NONE)
+	{
+		const Node &node = m_nodes[m_table[slot]];
+		if (node.nw == nw && node.ne == ne && node.sw == sw && node.se == se)
+		{
+			return m_table[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	Node node;
+	node.nw = nw;
+	node.ne = ne;
+	node.sw = sw;
+	node.se = se;
+	node.result = NONE;
+	node.level = m_nodes[nw].level + 1;
+	node.resultStep = -1;
+	node.mark = 0;
+	node.population = m_nodes[nw].population + m_nodes[ne].population + m_nodes[sw].population + m_nodes[se].population;
+
+	uint32_t n;
+	if (!m_freeNodes.empty())
+	{
+		n = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		m_nodes[n] = node;
+	}
+	else
+	{
+		n = (uint32_t)m_nodes.size();
+		m_nodes.push_back(node);
+	}
+
+	//keep the table at most half full
+	if ((m_tableCount + 1) * 2 > m_table.size())
+	{
+		rebuildTable(m_table.size() * 2); //inserts n as well
+	}
+	else
+	{
+		m_table[slot] = n;
+		m_tableCount++;
+	}
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::empty(int level)
+{
+	if (m_empty.empty())
+	{
+		m_empty.push_back(DEAD);
+	}
+	while ((int)m_empty.size() <= level)
+	{
+		uint32_t e = m_empty.back();
+		m_empty.push_back(join(e, e, e, e));
+	}
+	return m_empty[level];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::centre(uint32_t n)
+{
+	Node node = m_nodes[n];
+	return join(m_nodes[node.nw].se, m_nodes[node.ne].sw, m_nodes[node.sw].ne, m_nodes[node.se].nw);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::baseResult(uint32_t n)
+{
+	const Node &node = m_nodes[n];
+	uint32_t quads[4] = { node.nw, node.ne, node.sw, node.se };
+	int bits = 0;
+	for (int q = 0; q < 4; q++)
+	{
+		const Node &quad = m_nodes[quads[q]];
+		int qx = (q & 1) * 2;
+		int qy = (q >> 1) * 2;
+		bits |= (int)m_nodes[quad.nw].population << (qy * 4 + qx);
+		bits |= (int)m_nodes[quad.ne].population << (qy * 4 + qx + 1);
+		bits |= (int)m_nodes[quad.sw].population << ((qy + 1) * 4 + qx);
+		bits |= (int)m_nodes[quad.se].population << ((qy + 1) * 4 + qx + 1);
+	}
+	uint8_t out = m_baseTable[bits];
+	return join(out & 1, (out >> 1) & 1, (out >> 2) & 1, (out >> 3) & 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::result(uint32_t n)
+{
+	int level = m_nodes[n].level;
+	int step = (level - 2 < m_step) ? level - 2 : m_step;
+	if (m_nodes[n].result != NONE && m_nodes[n].resultStep == step)
+	{
+		return m_nodes[n].result;
+	}
+
+	uint32_t out;
+	if (m_nodes[n].population == 0)
+	{
+		out = empty(level - 1);
+	}
+	else if (level == 2)
+	{
+		out = baseResult(n);
+	}
+	else
+	{
+		//copy, m_nodes can grow while joining
+		Node a = m_nodes[m_nodes[n].nw];
+		Node b = m_nodes[m_nodes[n].ne];
+		Node c = m_nodes[m_nodes[n].sw];
+		Node d = m_nodes[m_nodes[n].se];
+		uint32_t nw = m_nodes[n].nw, ne = m_nodes[n].ne, sw = m_nodes[n].sw, se = m_nodes[n].se;
+
+		//nine overlapping squares of level - 1
+		uint32_t sub[9] =
+		{
+			nw,								join(a.ne, b.nw, a.se, b.sw),	ne,
+			join(a.sw, a.se, c.nw, c.ne),	join(a.se, b.sw, c.ne, d.nw),	join(b.sw, b.se, d.nw, d.ne),
+			sw,								join(c.ne, d.nw, c.se, d.sw),	se
+		};
+
+		//full step: both halves advance, half step: first half only takes the centres
+		bool fullStep = (step == level - 2);
+		for (int i = 0; i < 9; i++)
+		{
+			sub[i] = fullStep ? result(sub[i]) : centre(sub[i]);
+		}
+
+		uint32_t q00 = result(join(sub[0], sub[1], sub[3], sub[4]));
+		uint32_t q01 = result(join(sub[1], sub[2], sub[4], sub[5]));
+		uint32_t q10 = result(join(sub[3], sub[4], sub[6], sub[7]));
+		uint32_t q11 = result(join(sub[4], sub[5], sub[7], sub[8]));
+		out = join(q00, q01, q10, q11);
+	}
+
+	m_nodes[n].result = out;
+	m_nodes[n].resultStep = (int8_t)step;
+	return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::expand()
+{
+	Node root = m_nodes[m_root];
+	uint32_t e = empty(root.level - 1);
+	uint32_t nw = join(e, e, e, root.nw);
+	uint32_t ne = join(e, e, root.ne, e);
+	uint32_t sw = join(e, root.sw, e, e);
+	uint32_t se = join(root.se, e, e, e);
+	m_root = join(nw, ne, sw, se);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HashLife::fitsInner() const
+{
+	const Node &root = m_nodes[m_root];
+	if (root.level < 3)
+	{
+		return false;
+	}
+	uint64_t inner = m_nodes[m_nodes[m_nodes[root.nw].se].se].population + m_nodes[m_nodes[m_nodes[root.ne].sw].sw].population +
+					 m_nodes[m_nodes[m_nodes[root.sw].ne].ne].population + m_nodes[m_nodes[m_nodes[root.se].nw].nw].population;
+	return inner == root.population;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::advancePow2(int k)
+{
+	m_step = k;
+
+	//pattern has to stay inside the result: it grows at most 2^k cells to each side
+	while (m_nodes[m_root].level < k + 3 || !fitsInner())
+	{
+		expand();
+	}
+	m_root = result(m_root);
+	m_generation += 1ULL << k;
+
+	if (nodeCount() > m_maxNodes)
+	{
+		collectGarbage();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HashLife::advanceTo(uint64_t generation)
+{
+	if (generation < m_generation)
+	{
+		return false;
+	}
+
+	uint64_t remaining = generation - m_generation;
+	for (int k = 63; k >= 0; k--)
+	{
+		if ((remaining >> k) & 1)
+		{
+			advancePow2(k);
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::collectGarbage()
+{
+	//mark everything reachable from the root and the empty nodes
+	std::vector<uint32_t> stack(m_empty.begin(), m_empty.end());
+	stack.push_back(m_root);
+	while (!stack.empty())
+	{
+		uint32_t n = stack.back();
+		stack.pop_back();
+		Node &node = m_nodes[n];
+		if (node.mark || n <= ALIVE)
+		{
+			continue;
+		}
+		node.mark = 1;
+		stack.push_back(node.nw);
+		stack.push_back(node.ne);
+		stack.push_back(node.sw);
+		stack.push_back(node.se);
+	}
+
+	//forget results pointing at nodes that are freed, free the unmarked nodes
+	m_freeNodes.clear();
+	for (uint32_t n = ALIVE + 1; n < m_nodes.size(); n++)
+	{
+		Node &node = m_nodes[n];
+		if (node.mark)
+		{
+			if (node.result > ALIVE && node.result != NONE && !m_nodes[node.result].mark)
+			{
+				node.result = NONE;
+			}
+		}
+		else
+		{
+			node.level = -1;
+			node.result = NONE;
+			m_freeNodes.push_back(n);
+		}
+	}
+	for (Node &node : m_nodes)
+	{
+		node.mark = 0;
+	}
+
+	size_t tableSize = 1024;
+	while (tableSize < nodeCount() * 4)
+	{
+		tableSize *= 2;
+	}
+	rebuildTable(tableSize);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::setCell(uint32_t n, int64_t x, int64_t y, bool alive)
+{
+	Node node = m_nodes[n];
+	if (node.level == 0)
+	{
+		return alive ? ALIVE : DEAD;
+	}
+
+	int64_t half = (int64_t)1 << (node.level - 1);
+	if (y < half)
+	{
+		if (x < half)
+			node.nw = setCell(node.nw, x, y, alive);
+		else
+			node.ne = setCell(node.ne, x - half, y, alive);
+	}
+	else
+	{
+		if (x < half)
+			node.sw = setCell(node.sw, x, y - half, alive);
+		else
+			node.se = setCell(node.se, x - half, y - half, alive);
+	}
+	return join(node.nw, node.ne, node.sw, node.se);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::setCell(int64_t x, int64_t y, bool alive)
+{
+	//root covers -half..half-1 on both axes
+	while (true)
+	{
+		int64_t half = (int64_t)1 << (m_nodes[m_root].level - 1);
+		if (x >= -half && x < half && y >= -half && y < half)
+		{
+			m_root = setCell(m_root, x + half, y + half, alive);
+			return;
+		}
+		expand();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HashLife::getCell(int64_t x, int64_t y) const
+{
+	uint32_t n = m_root;
+	int64_t half = (int64_t)1 << (m_nodes[n].level - 1);
+	if (x < -half || x >= half || y < -half || y >= half)
+	{
+		return false;
+	}
+	x += half;
+	y += half;
+
+	while (m_nodes[n].level > 0 && m_nodes[n].population > 0)
+	{
+		const Node &node = m_nodes[n];
+		half = (int64_t)1 << (node.level - 1);
+		bool east = x >= half;
+		bool south = y >= half;
+		n = south ? (east ? node.se : node.sw) : (east ? node.ne : node.nw);
+		x -= east ? half : 0;
+		y -= south ? half : 0;
+	}
+	return m_nodes[n].population > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint32_t HashLife::build(const int *cells, int width, int height, int stride, int level, int64_t left, int64_t top)
+{
+	int64_t size = (int64_t)1 << level;
+	if (left >= width || top >= height || left + size <= 0 || top + size <= 0)
+	{
+		return empty(level);
+	}
+	if (level == 0)
+	{
+		return cells[top * stride + left] == 1 ? ALIVE : DEAD;
+	}
+
+	int64_t half = size / 2;
+	uint32_t nw = build(cells, width, height, stride, level - 1, left, top);
+	uint32_t ne = build(cells, width, height, stride, level - 1, left + half, top);
+	uint32_t sw = build(cells, width, height, stride, level - 1, left, top + half);
+	uint32_t se = build(cells, width, height, stride, level - 1, left + half, top + half);
+	return join(nw, ne, sw, se);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::load(const int *cells, int width, int height, int stride)
+{
+	clear();
+
+	//root centred at 0 0 that is large enough to hold the board
+	int level = 3;
+	while (((int64_t)1 << (level - 1)) < width || ((int64_t)1 << (level - 1)) < height)
+	{
+		level++;
+	}
+	int64_t half = (int64_t)1 << (level - 1);
+	m_root = build(cells, width, height, stride, level, -half, -half);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::extract(uint32_t n, int64_t left, int64_t top, int *cells, int width, int height, int stride) const
+{
+	const Node &node = m_nodes[n];
+	int64_t size = (int64_t)1 << node.level;
+	if (node.population == 0 || left >= width || top >= height || left + size <= 0 || top + size <= 0)
+	{
+		return;
+	}
+	if (node.level == 0)
+	{
+		cells[top * stride + left] = 1;
+		return;
+	}
+
+	int64_t half = size / 2;
+	extract(node.nw, left, top, cells, width, height, stride);
+	extract(node.ne, left + half, top, cells, width, height, stride);
+	extract(node.sw, left, top + half, cells, width, height, stride);
+	extract(node.se, left + half, top + half, cells, width, height, stride);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HashLife::store(int *cells, int width, int height, int stride) const
+{
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			cells[y * stride + x] = 0;
+		}
+	}
+	int64_t half = (int64_t)1 << (m_nodes[m_root].level - 1);
+	extract(m_root, -half, -half, cells, width, height, stride);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Visit>
+inline void HashLife::forEachAlive(Visit visit) const
+{
+	int64_t half = (int64_t)1 << (m_nodes[m_root].level - 1);
+	visitAlive(m_root, -half, -half, visit);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Visit>
+inline void HashLife::visitAlive(uint32_t n, int64_t left, int64_t top, Visit &visit) const
+{
+	const Node &node = m_nodes[n];
+	if (node.population == 0)
+	{
+		return;
+	}
+	if (node.level == 0)
+	{
+		visit(left, top);
+		return;
+	}
+
+	int64_t half = (int64_t)1 << (node.level - 1);
+	visitAlive(node.nw, left, top, visit);
+	visitAlive(node.ne, left + half, top, visit);
+	visitAlive(node.sw, left, top + half, visit);
+	visitAlive(node.se, left + half, top + half, visit);
+}
@@ -0,0 +1,638 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LifeEngine.h"
+#include "BitBoard.h"
+#include "LazyMemory.h"
+
+/**
+	Bit-packed board of up to MAX_SIDE x MAX_SIDE cells in lazily committed memory, with 64-bit sizes and indices.
+
+	The board is stored as tiles of 64 x 64 cells (one word per row, 512 bytes), tile tx ty is tile number
+	ty * tilesX + tx in a LazyBuffer per generation. A tile that was never written takes no memory and reads as dead,
+	so an empty 1M x 1M board reserves 2 x 128 GB of address space and commits almost nothing. A 64 KB block of
+	memory holds a run of 128 tiles, 8192 x 64 cells of one tile row.
+
+	Only tiles that changed in the previous generation and their neighbours are computed, as in TiledEngine. A tile
+	that stays dead is not written, so memory is only committed where cells have been alive. The work of a step
+	follows the active tiles and the memory the area that has been alive, neither the board size.
+
+	The bounding box of the alive cells is kept without looking at quiet tiles: the number of tiles with alive cells
+	is counted for every tile row and tile column, the first and last counted ones give the tiles the box lies in and
+	only the tiles on its edges are looked at to find the cells.
+
+	Cell hash keys are y * width + x as 64-bit numbers, the same as on the int board engines. load and store take an
+	int board for boards of int size, bigger boards are filled with set.
+*/
+
+class HugeEngine : public LifeEngine
+{
+public:
+	static const int TILE_SIZE = 64;
+	static const uint64_t MAX_SIDE = 1 << 20;
+
+	HugeEngine() : m_width(0), m_height(0), m_tilesX(0), m_tilesY(0), m_lastMask(0), m_phase(0), m_population(0), m_computed(0) {}
+
+	const char *name() const override { return "huge"; }
+	std::string stepReport() const override;
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setRule(const Rule &rule) override;
+
+	//makes an empty board of width x height (1..MAX_SIDE), returns false with a message in error when it can't
+	bool resize(uint64_t width, uint64_t height, std::string &error);
+
+	uint64_t width() const { return m_width; }
+	uint64_t height() const { return m_height; }
+
+	bool get(uint64_t x, uint64_t y) const;
+
+	//sets a cell, returns false when the memory for it can't be committed
+	bool set(uint64_t x, uint64_t y, bool alive);
+
+	//sets row y from (width + 63) / 64 words of 64 cells, returns false when memory for it can't be committed,
+	//words equal to the board commit nothing, rows that are already right need not be set at all
+	bool setRow(uint64_t y, const uint64_t *words);
+
+	long long population() const { return m_population; }
+
+	//address space taken by the board and memory committed in it
+	uint64_t reservedBytes() const;
+	uint64_t residentBytes() const;
+
+private:
+	static const uint64_t TILE_BYTES = TILE_SIZE * sizeof(uint64_t);
+
+	//rows of tile t of a generation, a tile that was never written is the zero tile
+	const uint64_t *readTile(int phase, uint64_t t) const;
+
+	//writable rows of tile t, commits its memory, nullptr when out of memory
+	uint64_t *writeTile(int phase, uint64_t t);
+
+	//what stepTile found out about a tile
+	enum TileFlags : uint8_t { TILE_CHANGED = 1, TILE_WAS_ALIVE = 2, TILE_IS_ALIVE = 4 };
+
+	//computes the next generation of tile t, returns TileFlags
+	template<class RuleType>
+	uint8_t stepTile(const RuleType &rule, uint64_t t, StepStats &stats);
+
+	//marks tile t changed so it and its neighbours are computed in the next step
+	void markChanged(uint64_t t);
+
+	//keeps the tiles of the tile row starting at firstTile once at the end of m_changed
+	void uniqueChangedRow(uint64_t firstTile);
+
+	//true when tile t of the current generation has no alive cells
+	bool tileEmpty(uint64_t t) const;
+
+	//counts tile t in or out of the tiles with alive cells
+	void countTile(uint64_t t, bool alive);
+
+	//alive cells of the current generation
+	CellBounds cellBounds() const;
+
+	//number of tiles with alive cells per tile row or column, first and last are the outermost counted ones
+	struct TileSpan
+	{
+		std::vector<uint32_t> counts;
+		uint64_t first = 0;
+		uint64_t last = 0;
+		uint64_t used = 0;		//entries above zero
+
+		void reset(uint64_t size) { counts.assign(size, 0); first = last = used = 0; }
+
+		void add(uint64_t i)
+		{
+			if (counts[i]++ == 0)
+			{
+				first = used == 0 || i < first ? i : first;
+				last = used == 0 || i > last ? i : last;
+				used++;
+			}
+		}
+
+		void remove(uint64_t i)
+		{
+			if (--counts[i] == 0 && --used > 0)
+			{
+				while (counts[first] == 0) //only the edges move inwards
+				{
+					first++;
+				}
+				while (counts[last] == 0)
+				{
+					last--;
+				}
+			}
+		}
+	};
+
+	uint64_t m_width;
+	uint64_t m_height;
+	uint64_t m_tilesX;
+	uint64_t m_tilesY;
+	uint64_t m_lastMask;			//bits of the last tile column that are on the board
+	int m_phase;
+	long long m_population;
+	size_t m_computed;				//tiles computed in the last step
+	LazyBuffer m_tiles[2];			//current and next generation
+	LazyBuffer m_queued;			//bit per tile, set while the tile is in m_queue
+	std::vector<uint64_t> m_changed;	//tiles changed in the previous generation
+	std::vector<uint64_t> m_queue;		//tiles computed in this step
+	std::vector<uint8_t> m_queueFlags;	//TileFlags of the tiles of m_queue
+	TileSpan m_rowTiles;			//tiles with alive cells per tile row
+	TileSpan m_columnTiles;			//and per tile column
+	bool m_outOfMemory = false;
+	uint64_t m_zeroTile[TILE_SIZE] = {};
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::string HugeEngine::stepReport() const
+{
+	char text[160];
+	snprintf(text, sizeof(text), "tiles computed: %zu, memory: %.1f MB resident, %.1f MB of address space reserved%s", m_computed,
+			 residentBytes() / (1024.0 * 1024.0), reservedBytes() / (1024.0 * 1024.0), m_outOfMemory ? ", OUT OF MEMORY" : "");
+	return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t HugeEngine::reservedBytes() const
+{
+	return m_tiles[0].reservedBytes() + m_tiles[1].reservedBytes() + m_queued.reservedBytes();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t HugeEngine::residentBytes() const
+{
+	return m_tiles[0].committedBytes() + m_tiles[1].committedBytes() + m_queued.committedBytes() +
+		   m_tiles[0].bookkeepingBytes() + m_tiles[1].bookkeepingBytes() + m_queued.bookkeepingBytes() +
+		   (m_changed.capacity() + m_queue.capacity()) * sizeof(uint64_t) + m_queueFlags.capacity() +
+		   (m_rowTiles.counts.capacity() + m_columnTiles.counts.capacity()) * sizeof(uint32_t);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::resize(uint64_t width, uint64_t height, std::string &error)
+{
+	if (width < 1 || height < 1 || width > MAX_SIDE || height > MAX_SIDE)
+	{
+		error = "board sides must be 1 - " + std::to_string(MAX_SIDE);
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_lastMask = (width % 64) ? ((uint64_t)1 << (width % 64)) - 1 : ~(uint64_t)0;
+	m_phase = 0;
+	m_population = 0;
+	m_computed = 0;
+	m_outOfMemory = false;
+	m_changed.clear();
+	m_queue.clear();
+	m_rowTiles.reset(m_tilesY);
+	m_columnTiles.reset(m_tilesX);
+
+	uint64_t tiles = m_tilesX * m_tilesY;
+	if (!m_tiles[0].reserve(tiles * TILE_BYTES) || !m_tiles[1].reserve(tiles * TILE_BYTES) || !m_queued.reserve((tiles + 7) / 8))
+	{
+		error = "can't reserve " + std::to_string(2 * tiles * TILE_BYTES >> 20) + " MB of address space";
+		m_tiles[0].release();
+		m_tiles[1].release();
+		m_queued.release();
+		m_width = m_height = m_tilesX = m_tilesY = 0;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const uint64_t *HugeEngine::readTile(int phase, uint64_t t) const
+{
+	const LazyBuffer &tiles = m_tiles[phase];
+	return tiles.committed(t * TILE_BYTES) ? (const uint64_t *)(tiles.data() + t * TILE_BYTES) : m_zeroTile;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t *HugeEngine::writeTile(int phase, uint64_t t)
+{
+	LazyBuffer &tiles = m_tiles[phase];
+	if (!tiles.commit(t * TILE_BYTES))
+	{
+		m_outOfMemory = true;
+		return nullptr;
+	}
+	return (uint64_t *)(tiles.data() + t * TILE_BYTES);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HugeEngine::markChanged(uint64_t t)
+{
+	if (m_changed.empty() || m_changed.back() != t) //set on a run of cells of one tile
+	{
+		m_changed.push_back(t);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::tileEmpty(uint64_t t) const
+{
+	const uint64_t *rows = readTile(m_phase, t);
+	for (int r = 0; r < TILE_SIZE; r++)
+	{
+		if (rows[r])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HugeEngine::countTile(uint64_t t, bool alive)
+{
+	if (alive)
+	{
+		m_rowTiles.add(t / m_tilesX);
+		m_columnTiles.add(t % m_tilesX);
+	}
+	else
+	{
+		m_rowTiles.remove(t / m_tilesX);
+		m_columnTiles.remove(t % m_tilesX);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline CellBounds HugeEngine::cellBounds() const
+{
+	CellBounds bounds;
+	if (m_rowTiles.used == 0)
+	{
+		return bounds;
+	}
+
+	//the box lies in these tiles, every tile row and column between has alive cells only on the inside
+	uint64_t tx0 = m_columnTiles.first, tx1 = m_columnTiles.last;
+	uint64_t ty0 = m_rowTiles.first, ty1 = m_rowTiles.last;
+	bounds.top = (long long)(ty1 + 1) * TILE_SIZE;
+	bounds.bottom = -1;
+	for (uint64_t tx = tx0; tx <= tx1; tx++)
+	{
+		const uint64_t *top = readTile(m_phase, ty0 * m_tilesX + tx);
+		const uint64_t *bottom = readTile(m_phase, ty1 * m_tilesX + tx);
+		for (int r = 0; r < TILE_SIZE; r++)
+		{
+			if (top[r])
+			{
+				bounds.top = (std::min)(bounds.top, (long long)(ty0 * TILE_SIZE + r));
+				break;
+			}
+		}
+		for (int r = TILE_SIZE - 1; r >= 0; r--)
+		{
+			if (bottom[r])
+			{
+				bounds.bottom = (std::max)(bounds.bottom, (long long)(ty1 * TILE_SIZE + r));
+				break;
+			}
+		}
+	}
+
+	uint64_t leftColumns = 0, rightColumns = 0;
+	for (uint64_t ty = ty0; ty <= ty1; ty++)
+	{
+		const uint64_t *left = readTile(m_phase, ty * m_tilesX + tx0);
+		const uint64_t *right = readTile(m_phase, ty * m_tilesX + tx1);
+		for (int r = 0; r < TILE_SIZE; r++)
+		{
+			leftColumns |= left[r];
+			rightColumns |= right[r];
+		}
+	}
+	bounds.left = (long long)(tx0 * TILE_SIZE + lowestBit64(leftColumns));
+	bounds.right = (long long)(tx1 * TILE_SIZE + highestBit64(rightColumns));
+	return bounds;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::get(uint64_t x, uint64_t y) const
+{
+	uint64_t t = (y / TILE_SIZE) * m_tilesX + x / TILE_SIZE;
+	return (readTile(m_phase, t)[y % TILE_SIZE] >> (x % 64)) & 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::set(uint64_t x, uint64_t y, bool alive)
+{
+	uint64_t t = (y / TILE_SIZE) * m_tilesX + x / TILE_SIZE;
+	uint64_t bit = (uint64_t)1 << (x % 64);
+	if (((readTile(m_phase, t)[y % TILE_SIZE] & bit) != 0) == alive)
+	{
+		return true;
+	}
+	bool wasEmpty = alive && tileEmpty(t);
+	uint64_t *rows = writeTile(m_phase, t);
+	if (!rows)
+	{
+		return false;
+	}
+	rows[y % TILE_SIZE] ^= bit;
+	if (wasEmpty || (!alive && tileEmpty(t)))
+	{
+		countTile(t, alive);
+	}
+	m_population += alive ? 1 : -1;
+	markChanged(t);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::setRow(uint64_t y, const uint64_t *words)
+{
+	uint64_t firstTile = (y / TILE_SIZE) * m_tilesX;
+	for (uint64_t i = 0; i < m_tilesX; i++)
+	{
+		uint64_t t = firstTile + i;
+		uint64_t old = readTile(m_phase, t)[y % TILE_SIZE];
+		if (old == words[i])
+		{
+			continue;
+		}
+		if (!m_changed.empty() && m_changed.back() < firstTile) //the last row of the tile row before may have been skipped
+		{
+			uniqueChangedRow(m_changed.back() - m_changed.back() % m_tilesX);
+		}
+		bool wasEmpty = tileEmpty(t);
+		uint64_t *rows = writeTile(m_phase, t);
+		if (!rows)
+		{
+			return false;
+		}
+		rows[y % TILE_SIZE] = words[i];
+		if (wasEmpty != tileEmpty(t))
+		{
+			countTile(t, wasEmpty);
+		}
+		m_population += popcount64(words[i]) - popcount64(old);
+		markChanged(t);
+	}
+
+	//rows of a tile row mark its tiles once per row, keep them once when its last row is in
+	if (y % TILE_SIZE == TILE_SIZE - 1 || y == m_height - 1)
+	{
+		uniqueChangedRow(firstTile);
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HugeEngine::uniqueChangedRow(uint64_t firstTile)
+{
+	auto band = m_changed.end();
+	while (band != m_changed.begin() && *(band - 1) >= firstTile && *(band - 1) < firstTile + m_tilesX)
+	{
+		band--;
+	}
+	std::sort(band, m_changed.end());
+	m_changed.erase(std::unique(band, m_changed.end()), m_changed.end());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HugeEngine::load(const int *cells, int width, int height, int stride)
+{
+	std::string error;
+	if (!resize(width, height, error))
+	{
+		return;
+	}
+	for (int y = 0; y < height; y++)
+	{
+		for (int x0 = 0; x0 < width; x0 += 64)
+		{
+			uint64_t bits = 0;
+			for (int x = x0; x < width && x < x0 + 64; x++)
+			{
+				bits |= (uint64_t)(cells[(size_t)y * stride + x] == 1) << (x - x0);
+			}
+			if (!bits)
+			{
+				continue;
+			}
+			uint64_t t = (uint64_t)(y / TILE_SIZE) * m_tilesX + x0 / TILE_SIZE;
+			bool wasEmpty = tileEmpty(t);
+			uint64_t *rows = writeTile(m_phase, t);
+			if (rows)
+			{
+				if (wasEmpty)
+				{
+					countTile(t, true);
+				}
+				rows[y % TILE_SIZE] = bits;
+				m_population += popcount64(bits);
+				markChanged(t);
+			}
+		}
+	}
+	//rows of one tile came in one after the other, markChanged only caught repeats in a row
+	std::sort(m_changed.begin(), m_changed.end());
+	m_changed.erase(std::unique(m_changed.begin(), m_changed.end()), m_changed.end());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void HugeEngine::store(int *cells, int stride) const
+{
+	for (uint64_t y = 0; y < m_height; y++)
+	{
+		for (uint64_t x0 = 0; x0 < m_width; x0 += 64)
+		{
+			uint64_t bits = readTile(m_phase, (y / TILE_SIZE) * m_tilesX + x0 / TILE_SIZE)[y % TILE_SIZE];
+			for (uint64_t x = x0; x < m_width && x < x0 + 64; x++)
+			{
+				cells[y * stride + x] = (int)((bits >> (x - x0)) & 1);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool HugeEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	m_rule = rule;
+
+	//quiet tiles may change under the new rule, and dead ones too when cells are around them
+	m_changed.clear();
+	for (uint64_t t = 0; t < m_tilesX * m_tilesY; t++)
+	{
+		if (m_tiles[m_phase].committed(t * TILE_BYTES))
+		{
+			m_changed.push_back(t);
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class RuleType>
+inline uint8_t HugeEngine::stepTile(const RuleType &rule, uint64_t t, StepStats &stats)
+{
+	uint64_t tx = t % m_tilesX;
+	uint64_t ty = t / m_tilesX;
+
+	//rows -1..64 of the three tile columns, the board edge is dead
+	uint64_t columns[3][66];
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		uint64_t *column = columns[dx + 1];
+		if ((dx < 0 && tx == 0) || (dx > 0 && tx + 1 == m_tilesX))
+		{
+			std::fill(column, column + 66, 0);
+			continue;
+		}
+		const uint64_t *above = ty > 0 ? readTile(m_phase, t - m_tilesX + dx) : m_zeroTile;
+		const uint64_t *middle = readTile(m_phase, t + dx);
+		const uint64_t *below = ty + 1 < m_tilesY ? readTile(m_phase, t + m_tilesX + dx) : m_zeroTile;
+		column[0] = above[TILE_SIZE - 1];
+		std::copy(middle, middle + TILE_SIZE, column + 1);
+		column[TILE_SIZE + 1] = below[0];
+	}
+
+	uint64_t next[TILE_SIZE];
+	stepBitTile(rule, columns, next);
+
+	//cells past the right and bottom edge stay dead
+	uint64_t mask = tx + 1 == m_tilesX ? m_lastMask : ~(uint64_t)0;
+	uint64_t rows = (std::min)(m_height - ty * TILE_SIZE, (uint64_t)TILE_SIZE);
+	long long population = 0;
+	long long oldPopulation = 0;
+	uint64_t changed = 0;
+	for (uint64_t r = 0; r < TILE_SIZE; r++)
+	{
+		next[r] = r < rows ? next[r] & mask : 0;
+		uint64_t self = columns[1][r + 1];
+		population += popcount64(next[r]);
+		oldPopulation += popcount64(self);
+		stats.survivors += popcount64(next[r] & self);
+		if (next[r] != self) //births and deaths
+		{
+			changed |= next[r] ^ self;
+			stats.hashDelta ^= zobristBits((ty * TILE_SIZE + r) * m_width + tx * TILE_SIZE, next[r] ^ self);
+		}
+	}
+
+	//band stats hold the change of the population, step adds the cells of the tiles that were skipped
+	stats.aliveCount += population - oldPopulation;
+	stats.survivors -= oldPopulation;
+
+	//a dead tile that stays dead is not written, its memory stays uncommitted
+	const LazyBuffer &out = m_tiles[m_phase ^ 1];
+	if (population > 0 || out.committed(t * TILE_BYTES))
+	{
+		uint64_t *outRows = writeTile(m_phase ^ 1, t);
+		if (outRows)
+		{
+			std::copy(next, next + TILE_SIZE, outRows);
+		}
+	}
+	return (changed ? TILE_CHANGED : 0) | (oldPopulation ? TILE_WAS_ALIVE : 0) | (population ? TILE_IS_ALIVE : 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats HugeEngine::step()
+{
+	//changed tiles and their neighbours, each once, the queued bits make sure of that
+	m_queue.clear();
+	for (uint64_t t : m_changed)
+	{
+		uint64_t tx = t % m_tilesX;
+		uint64_t ty = t / m_tilesX;
+		for (uint64_t y = ty > 0 ? ty - 1 : 0; y <= ty + 1 && y < m_tilesY; y++)
+		{
+			for (uint64_t x = tx > 0 ? tx - 1 : 0; x <= tx + 1 && x < m_tilesX; x++)
+			{
+				uint64_t neighbour = y * m_tilesX + x;
+				if (!m_queued.commit(neighbour / 8))
+				{
+					m_outOfMemory = true;
+					continue;
+				}
+				unsigned char &bits = m_queued.data()[neighbour / 8];
+				if (!(bits & (1 << (neighbour % 8))))
+				{
+					bits |= 1 << (neighbour % 8);
+					m_queue.push_back(neighbour);
+				}
+			}
+		}
+	}
+	for (uint64_t t : m_queue)
+	{
+		m_queued.data()[t / 8] = 0;
+	}
+	std::sort(m_queue.begin(), m_queue.end()); //memory is walked in order
+	m_queueFlags.assign(m_queue.size(), 0);
+
+	StepStats delta = forEachBand((int)m_queue.size(), [&](int first, int last, StepStats &bandStats)
+	{
+		withRule(m_rule, [&](const auto &rule)
+		{
+			for (int i = first; i < last; i++)
+			{
+				m_queueFlags[i] = stepTile(rule, m_queue[i], bandStats);
+			}
+		});
+	});
+	m_computed = m_queue.size();
+
+	m_changed.clear();
+	for (size_t i = 0; i < m_queue.size(); i++)
+	{
+		uint8_t flags = m_queueFlags[i];
+		if (flags & TILE_CHANGED)
+		{
+			m_changed.push_back(m_queue[i]);
+		}
+		if (!(flags & TILE_WAS_ALIVE) != !(flags & TILE_IS_ALIVE))
+		{
+			countTile(m_queue[i], (flags & TILE_IS_ALIVE) != 0);
+		}
+	}
+
+	//every cell of a skipped tile survived
+	StepStats stats;
+	stats.aliveCount = m_population + delta.aliveCount;
+	stats.survivors = m_population + delta.survivors;
+	stats.hashDelta = delta.hashDelta;
+	m_population = stats.aliveCount;
+	m_phase ^= 1;
+	stats.bounds = cellBounds();
+	return stats;
+}
@@ -0,0 +1,522 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LifeEngine.h"
+#include "BitBoard.h"
+
+/**
+	Unbounded plane stored as a hash map of bit-packed chunks of 64 x 64 cells, for Boundary::Infinite.
+
+	Cell coordinates are 64-bit, chunk cx cy holds cells cx * 64.. cx * 64 + 63 and cy * 64.. cy * 64 + 63, one word
+	per row like a tile of TiledEngine. Only chunks with alive cells exist. A chunk is computed when it or one of its
+	eight neighbours changed in the previous generation, a missing chunk is created when a changed neighbour has alive
+	cells on the edge facing it, and a chunk that is empty and did not change is freed. Memory and work follow the
+	live population and its activity, not the area it spreads over.
+
+	The int board of load and store is a window onto the plane with its top left corner at 0 0. Cells that leave the
+	window live on and come back into view when they return. Inside the window a cell hashes with the usual key of
+	y * width + x, outside with a key of its coordinates, so hashes of boards that stay inside the window are the same
+	as on the other engines.
+*/
+
+class InfiniteEngine : public LifeEngine
+{
+public:
+	static const int CHUNK_SIZE = 64;
+
+	InfiniteEngine() : m_width(0), m_height(0), m_phase(0), m_stamp(0), m_population(0), m_computed(0) {}
+
+	const char *name() const override { return "infinite"; }
+	std::string stepReport() const override;
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setBoundary(Boundary boundary) override { return boundary == Boundary::Infinite; }
+	bool setRule(const Rule &rule) override;
+
+	//cell of the plane at any 64-bit coordinate
+	bool get(int64_t x, int64_t y) const;
+	void set(int64_t x, int64_t y, bool alive);
+
+	//alive cells on the whole plane
+	long long population() const { return m_population; }
+
+	//smallest rectangle holding every alive cell, returns false when the plane is empty
+	bool bounds(int64_t &minX, int64_t &minY, int64_t &maxX, int64_t &maxY) const;
+
+	//calls visit(x, y) for every alive cell of the plane, chunk by chunk
+	template<class Visit>
+	void forEachAlive(Visit visit) const;
+
+	size_t chunkCount() const { return m_chunks.size(); }
+
+private:
+	struct ChunkKey
+	{
+		int64_t x;
+		int64_t y;
+		bool operator==(const ChunkKey &other) const { return x == other.x && y == other.y; }
+	};
+
+	struct ChunkKeyHash
+	{
+		size_t operator()(const ChunkKey &key) const { return (size_t)(zobristKey((uint64_t)key.x) ^ ((uint64_t)key.y * 0x9E3779B97F4A7C15ULL)); }
+	};
+
+	struct Chunk
+	{
+		ChunkKey key;
+		uint64_t rows[2][CHUNK_SIZE];	//two generations, m_phase picks the current one
+		long long population;
+		CellBounds bounds;				//alive cells when the chunk was last computed, plane coordinates
+		bool changed;					//changed in the previous generation
+		uint64_t stamp;					//step that last queued the chunk
+	};
+
+	//chunk and its neighbours for one step, neighbours[1][1] is the chunk itself, missing chunks are nullptr
+	struct Job
+	{
+		Chunk *neighbours[3][3];
+	};
+
+	//chunk coordinate of a cell coordinate, rounds towards minus infinity
+	static int64_t chunkOf(int64_t v) { return (v - (v & (CHUNK_SIZE - 1))) / CHUNK_SIZE; }
+
+	Chunk *find(int64_t cx, int64_t cy) const;
+	Chunk *create(int64_t cx, int64_t cy);
+
+	//hash key of a plane cell, window cells use their window index
+	uint64_t cellKey(int64_t x, int64_t y) const;
+
+	//true when chunk has alive cells next to its neighbour in direction dx dy (-1 0 1)
+	bool edgeAlive(const Chunk &chunk, int dx, int dy) const;
+
+	//computes the next generation of the chunk in job.neighbours[1][1]
+	template<class RuleType>
+	void stepChunk(const RuleType &rule, const Job &job, StepStats &stats);
+
+	int m_width;			//window
+	int m_height;
+	int m_phase;
+	uint64_t m_stamp;
+	long long m_population;
+	size_t m_computed;		//chunks computed in the last step
+	std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, ChunkKeyHash> m_chunks;
+	std::vector<std::unique_ptr<Chunk>> m_free;	//freed chunks kept for reuse
+	std::vector<Job> m_jobs;
+	std::vector<ChunkKey> m_births;				//missing chunks that may get alive cells
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::string InfiniteEngine::stepReport() const
+{
+	int64_t minX, minY, maxX, maxY;
+	char text[160];
+	if (!bounds(minX, minY, maxX, maxY))
+	{
+		snprintf(text, sizeof(text), "plane: empty");
+		return text;
+	}
+	snprintf(text, sizeof(text), "plane: %lld alive in %lld,%lld - %lld,%lld, chunks %zu (%zu computed)", m_population,
+			 (long long)minX, (long long)minY, (long long)maxX, (long long)maxY, m_chunks.size(), m_computed);
+	return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline InfiniteEngine::Chunk *InfiniteEngine::find(int64_t cx, int64_t cy) const
+{
+	auto it = m_chunks.find(ChunkKey{ cx, cy });
+	return it == m_chunks.end() ? nullptr : it->second.get();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline InfiniteEngine::Chunk *InfiniteEngine::create(int64_t cx, int64_t cy)
+{
+	std::unique_ptr<Chunk> chunk;
+	if (!m_free.empty())
+	{
+		chunk = std::move(m_free.back());
+		m_free.pop_back();
+	}
+	else
+	{
+		chunk.reset(new Chunk());
+	}
+	chunk->key = ChunkKey{ cx, cy };
+	std::fill(&chunk->rows[0][0], &chunk->rows[0][0] + 2 * CHUNK_SIZE, 0);
+	chunk->population = 0;
+	chunk->bounds = CellBounds();
+	chunk->changed = false;
+	chunk->stamp = 0;
+
+	Chunk *created = chunk.get();
+	m_chunks[created->key] = std::move(chunk);
+	return created;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t InfiniteEngine::cellKey(int64_t x, int64_t y) const
+{
+	if (x >= 0 && y >= 0 && x < m_width && y < m_height)
+	{
+		return zobristKey((uint64_t)y * m_width + x);
+	}
+	//top bit keeps the keys apart from window indices
+	return zobristKey((zobristKey((uint64_t)x) ^ (uint64_t)y) | 0x8000000000000000ULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool InfiniteEngine::get(int64_t x, int64_t y) const
+{
+	const Chunk *chunk = find(chunkOf(x), chunkOf(y));
+	return chunk && ((chunk->rows[m_phase][y & (CHUNK_SIZE - 1)] >> (x & (CHUNK_SIZE - 1))) & 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void InfiniteEngine::set(int64_t x, int64_t y, bool alive)
+{
+	Chunk *chunk = find(chunkOf(x), chunkOf(y));
+	if (!chunk)
+	{
+		if (!alive)
+		{
+			return;
+		}
+		chunk = create(chunkOf(x), chunkOf(y));
+	}
+
+	uint64_t bit = (uint64_t)1 << (x & (CHUNK_SIZE - 1));
+	uint64_t &row = chunk->rows[m_phase][y & (CHUNK_SIZE - 1)];
+	if (((row & bit) != 0) == alive)
+	{
+		return;
+	}
+	row ^= bit;
+	chunk->rows[m_phase ^ 1][y & (CHUNK_SIZE - 1)] = row; //skipped chunks need both generations equal
+	chunk->population += alive ? 1 : -1;
+	m_population += alive ? 1 : -1;
+	chunk->changed = true; //chunk and its neighbours are computed in the next step
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool InfiniteEngine::bounds(int64_t &minX, int64_t &minY, int64_t &maxX, int64_t &maxY) const
+{
+	bool found = false;
+	for (const auto &entry : m_chunks)
+	{
+		const Chunk &chunk = *entry.second;
+		if (chunk.population == 0)
+		{
+			continue;
+		}
+
+		uint64_t columns = 0;
+		int top = CHUNK_SIZE;
+		int bottom = -1;
+		for (int r = 0; r < CHUNK_SIZE; r++)
+		{
+			uint64_t row = chunk.rows[m_phase][r];
+			if (row)
+			{
+				columns |= row;
+				top = top < r ? top : r;
+				bottom = r;
+			}
+		}
+		int left = lowestBit64(columns);
+		int right = 63;
+		while (!((columns >> right) & 1))
+		{
+			right--;
+		}
+
+		int64_t x0 = chunk.key.x * CHUNK_SIZE + left, x1 = chunk.key.x * CHUNK_SIZE + right;
+		int64_t y0 = chunk.key.y * CHUNK_SIZE + top, y1 = chunk.key.y * CHUNK_SIZE + bottom;
+		if (!found)
+		{
+			minX = x0, maxX = x1, minY = y0, maxY = y1;
+			found = true;
+			continue;
+		}
+		minX = (std::min)(minX, x0), maxX = (std::max)(maxX, x1);
+		minY = (std::min)(minY, y0), maxY = (std::max)(maxY, y1);
+	}
+	return found;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Visit>
+inline void InfiniteEngine::forEachAlive(Visit visit) const
+{
+	for (const auto &entry : m_chunks)
+	{
+		const Chunk &chunk = *entry.second;
+		if (chunk.population == 0)
+		{
+			continue;
+		}
+		for (int r = 0; r < CHUNK_SIZE; r++)
+		{
+			for (uint64_t bits = chunk.rows[m_phase][r]; bits; bits &= bits - 1)
+			{
+				visit(chunk.key.x * CHUNK_SIZE + lowestBit64(bits), chunk.key.y * CHUNK_SIZE + r);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void InfiniteEngine::load(const int *cells, int width, int height, int stride)
+{
+	for (auto &entry : m_chunks)
+	{
+		m_free.push_back(std::move(entry.second));
+	}
+	m_chunks.clear();
+	m_width = width;
+	m_height = height;
+	m_population = 0;
+
+	//one word of a window row at a time, only words with alive cells touch the map
+	for (int y = 0; y < height; y++)
+	{
+		for (int x0 = 0; x0 < width; x0 += CHUNK_SIZE)
+		{
+			uint64_t bits = 0;
+			for (int x = x0; x < width && x < x0 + CHUNK_SIZE; x++)
+			{
+				bits |= (uint64_t)(cells[y * stride + x] == 1) << (x - x0);
+			}
+			if (!bits)
+			{
+				continue;
+			}
+
+			Chunk *chunk = find(chunkOf(x0), chunkOf(y));
+			if (!chunk)
+			{
+				chunk = create(chunkOf(x0), chunkOf(y));
+			}
+			chunk->rows[0][y % CHUNK_SIZE] = bits;
+			chunk->rows[1][y % CHUNK_SIZE] = bits;
+			chunk->population += popcount64(bits);
+			chunk->changed = true; //everything is computed in the first generation
+			m_population += popcount64(bits);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void InfiniteEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x0 = 0; x0 < m_width; x0 += CHUNK_SIZE)
+		{
+			const Chunk *chunk = find(chunkOf(x0), chunkOf(y));
+			uint64_t bits = chunk ? chunk->rows[m_phase][y % CHUNK_SIZE] : 0;
+			for (int x = x0; x < m_width && x < x0 + CHUNK_SIZE; x++)
+			{
+				cells[y * stride + x] = (int)((bits >> (x - x0)) & 1);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool InfiniteEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	m_rule = rule;
+	for (auto &entry : m_chunks) //quiet chunks may change under the new rule
+	{
+		entry.second->changed = true;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool InfiniteEngine::edgeAlive(const Chunk &chunk, int dx, int dy) const
+{
+	const uint64_t *rows = chunk.rows[m_phase];
+	uint64_t columns = dx < 0 ? 1 : dx > 0 ? (uint64_t)1 << 63 : ~(uint64_t)0;
+	int first = dy < 0 ? 0 : dy > 0 ? CHUNK_SIZE - 1 : 0;
+	int last = dy < 0 ? 0 : dy > 0 ? CHUNK_SIZE - 1 : CHUNK_SIZE - 1;
+	for (int r = first; r <= last; r++)
+	{
+		if (rows[r] & columns)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class RuleType>
+inline void InfiniteEngine::stepChunk(const RuleType &rule, const Job &job, StepStats &stats)
+{
+	//rows -1..64 of the left, middle and right chunk column, rows outside come from the chunks above and below
+	uint64_t columns[3][66];
+	for (int dx = 0; dx < 3; dx++)
+	{
+		const Chunk *above = job.neighbours[0][dx];
+		const Chunk *middle = job.neighbours[1][dx];
+		const Chunk *below = job.neighbours[2][dx];
+		columns[dx][0] = above ? above->rows[m_phase][CHUNK_SIZE - 1] : 0;
+		for (int r = 0; r < CHUNK_SIZE; r++)
+		{
+			columns[dx][r + 1] = middle ? middle->rows[m_phase][r] : 0;
+		}
+		columns[dx][CHUNK_SIZE + 1] = below ? below->rows[m_phase][0] : 0;
+	}
+
+	Chunk &chunk = *job.neighbours[1][1];
+	uint64_t *out = chunk.rows[m_phase ^ 1];
+	stepBitTile(rule, columns, out);
+
+	long long population = 0;
+	bool changed = false;
+	chunk.bounds = CellBounds();
+	for (int r = 0; r < CHUNK_SIZE; r++)
+	{
+		uint64_t self = columns[1][r + 1];
+		population += popcount64(out[r]);
+		if (out[r])
+		{
+			addBitRowBounds(out + r, 1, chunk.key.x * CHUNK_SIZE, chunk.key.y * CHUNK_SIZE + r, chunk.bounds);
+		}
+		stats.survivors += popcount64(out[r] & self);
+
+		uint64_t flipped = out[r] ^ self;
+		if (flipped)
+		{
+			changed = true;
+			int64_t y = chunk.key.y * CHUNK_SIZE + r;
+			while (flipped)
+			{
+				stats.hashDelta ^= cellKey(chunk.key.x * CHUNK_SIZE + lowestBit64(flipped), y);
+				flipped &= flipped - 1;
+			}
+		}
+	}
+
+	chunk.population = population;
+	chunk.changed = changed;
+	stats.aliveCount += population;
+	stats.bounds.add(chunk.bounds);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats InfiniteEngine::step()
+{
+	//queue changed chunks, their neighbours and the missing neighbours that alive edge cells can reach
+	m_stamp++;
+	m_jobs.clear();
+	m_births.clear();
+	std::vector<Chunk *> queued;
+	for (const auto &entry : m_chunks)
+	{
+		const Chunk &chunk = *entry.second;
+		if (!chunk.changed)
+		{
+			continue;
+		}
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				Chunk *neighbour = find(chunk.key.x + dx, chunk.key.y + dy);
+				if (neighbour && neighbour->stamp != m_stamp)
+				{
+					neighbour->stamp = m_stamp;
+					queued.push_back(neighbour);
+				}
+				else if (!neighbour && edgeAlive(chunk, dx, dy))
+				{
+					m_births.push_back(ChunkKey{ chunk.key.x + dx, chunk.key.y + dy });
+				}
+			}
+		}
+	}
+	for (const ChunkKey &key : m_births) //created after the loop, inserting may rehash the map
+	{
+		if (!find(key.x, key.y))
+		{
+			Chunk *chunk = create(key.x, key.y);
+			chunk->stamp = m_stamp;
+			queued.push_back(chunk);
+		}
+	}
+
+	//neighbours are looked up once, the map doesn't change while chunks are stepped
+	m_jobs.resize(queued.size());
+	for (size_t i = 0; i < queued.size(); i++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				m_jobs[i].neighbours[dy + 1][dx + 1] = (dx || dy) ? find(queued[i]->key.x + dx, queued[i]->key.y + dy) : queued[i];
+			}
+		}
+	}
+
+	StepStats stats = forEachBand((int)m_jobs.size(), [&](int firstJob, int lastJob, StepStats &bandStats)
+	{
+		withRule(m_rule, [&](const auto &rule)
+		{
+			for (int i = firstJob; i < lastJob; i++)
+			{
+				stepChunk(rule, m_jobs[i], bandStats);
+			}
+		});
+	});
+	m_computed = m_jobs.size();
+
+	//chunks that were not computed kept their cells, empty chunks that settled are freed
+	for (auto it = m_chunks.begin(); it != m_chunks.end();)
+	{
+		Chunk &chunk = *it->second;
+		if (chunk.stamp != m_stamp)
+		{
+			chunk.changed = false;
+			stats.aliveCount += chunk.population;
+			stats.survivors += chunk.population;
+			stats.bounds.add(chunk.bounds); //a chunk that was changed by set is always computed, its box is current
+		}
+		if (chunk.population == 0 && !chunk.changed)
+		{
+			m_free.push_back(std::move(it->second));
+			it = m_chunks.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	m_phase ^= 1;
+	m_population = stats.aliveCount;
+	return stats;
+}
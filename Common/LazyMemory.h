@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/**
+	Zero filled buffer of any size that only takes memory where it is written.
+
+	reserve takes address space for the whole buffer without memory behind it. Memory is committed in blocks of
+	BLOCK_SIZE bytes: commit must be called for a block before anything in it is written, and a block that was never
+	committed must not be read, it is known to hold zeros. On Windows commit is VirtualAlloc with MEM_COMMIT, on other
+	systems the mapping is made with MAP_NORESERVE and the system brings pages in on their first write, commit only
+	does the bookkeeping. Committed blocks are counted, which is the resident memory of the buffer.
+	Blocks are not given back until the buffer is released.
+*/
+
+class LazyBuffer
+{
+public:
+	static const uint64_t BLOCK_SIZE = 64 * 1024; //allocation granularity of Windows
+
+	LazyBuffer() : m_data(nullptr), m_size(0), m_blocks(0), m_committedBlocks(0) {}
+	~LazyBuffer() { release(); }
+
+	LazyBuffer(const LazyBuffer &) = delete;
+	LazyBuffer &operator=(const LazyBuffer &) = delete;
+
+	//reserves address space for size bytes, returns false when the system refuses
+	bool reserve(uint64_t size);
+
+	//gives back the address space and every committed block
+	void release();
+
+	unsigned char *data() { return m_data; }
+	const unsigned char *data() const { return m_data; }
+
+	//true when the block holding byte offset has been committed
+	bool committed(uint64_t offset) const { return m_committed[offset / BLOCK_SIZE].load(std::memory_order_acquire) != 0; }
+
+	//commits the block holding byte offset, safe to call from several threads, returns false when out of memory
+	bool commit(uint64_t offset);
+
+	uint64_t reservedBytes() const { return m_size; }
+	uint64_t committedBytes() const { return m_committedBlocks.load() * BLOCK_SIZE; }
+
+	//memory of the commit flags, a byte per block
+	uint64_t bookkeepingBytes() const { return m_blocks; }
+
+private:
+	unsigned char *m_data;
+	uint64_t m_size;
+	uint64_t m_blocks;
+	std::unique_ptr<std::atomic<uint8_t>[]> m_committed;	//flag per block
+	std::atomic<uint64_t> m_committedBlocks;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool LazyBuffer::reserve(uint64_t size)
+{
+	release();
+	if (size == 0 || size > (uint64_t)SIZE_MAX - BLOCK_SIZE)
+	{
+		return false;
+	}
+	uint64_t blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	size = blocks * BLOCK_SIZE;
+#ifdef _WIN32
+	void *data = VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE, PAGE_READWRITE);
+#else
+	void *data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	data = data == MAP_FAILED ? nullptr : data;
+#endif
+	if (!data)
+	{
+		return false;
+	}
+
+	m_committed.reset(new std::atomic<uint8_t>[blocks]);
+	for (uint64_t block = 0; block < blocks; block++)
+	{
+		m_committed[block].store(0, std::memory_order_relaxed);
+	}
+	m_data = (unsigned char *)data;
+	m_size = size;
+	m_blocks = blocks;
+	m_committedBlocks = 0;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void LazyBuffer::release()
+{
+	if (!m_data)
+	{
+		return;
+	}
+#ifdef _WIN32
+	VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+	munmap(m_data, (size_t)m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_blocks = 0;
+	m_committed.reset();
+	m_committedBlocks = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool LazyBuffer::commit(uint64_t offset)
+{
+	uint64_t block = offset / BLOCK_SIZE;
+	if (m_committed[block].load(std::memory_order_acquire))
+	{
+		return true;
+	}
+#ifdef _WIN32
+	//committing a block twice is harmless, two threads may race here
+	if (!VirtualAlloc(m_data + block * BLOCK_SIZE, (SIZE_T)BLOCK_SIZE, MEM_COMMIT, PAGE_READWRITE))
+	{
+		return false;
+	}
+#endif
+	uint8_t expected = 0;
+	if (m_committed[block].compare_exchange_strong(expected, 1, std::memory_order_acq_rel))
+	{
+		m_committedBlocks++;
+	}
+	return true;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+#include "HaloGrid.h"
+#include "Rule.h"
+#include "Zobrist.h"
+
+/**
+	Common interface for the simulation engines shared by both GameOfLife projects.
+
+	GameOfLife keeps its own int board (1 alive, 0 dead) for drawing and placing cells. An engine holds its own copy
+	of the board in whatever layout suits its kernel, so the int board only has to be refreshed when it is needed.
+	Int boards are passed as pointer to cell 0 0 and the distance between rows (stride), so rows may be padded.
+	Cells outside of the board are treated as dead unless the engine accepts another boundary mode.
+
+	Row based engines step through forEachBand, which splits the board into bands of rows and runs them on the
+	thread pool when one is set. Every band writes only its own rows and its own stats, and the stats are added
+	in band order, so the result does not depend on the number of threads.
+	Every engine reports the Zobrist hash change of the step in its stats, see Zobrist.h.
+	The stats also hold the bounding box of the alive cells. Kernels count the alive cells of a row anyway, only rows
+	with alive cells are looked at again, from both ends while the row is still in cache, and engines that skip quiet
+	areas keep the box of each area.
+	Engines run B3/S23 unless setRule gives them another Life-like rule, see Rule.h.
+*/
+
+//Smallest rectangle holding a set of cells, edges are inclusive
+struct CellBounds
+{
+	long long left = 0;
+	long long top = 0;
+	long long right = -1;	//right < left while there are no cells
+	long long bottom = -1;
+
+	bool empty() const { return right < left; }
+
+	//grows over cells first..last of row y, rows are usually added from the top down
+	void addRow(long long y, long long first, long long last)
+	{
+		if (empty())
+		{
+			left = first;
+			right = last;
+			top = bottom = y;
+			return;
+		}
+		left = first < left ? first : left;
+		right = last > right ? last : right;
+		top = y < top ? y : top;
+		bottom = y > bottom ? y : bottom;
+	}
+
+	void add(const CellBounds &other)
+	{
+		if (!other.empty())
+		{
+			addRow(other.top, other.left, other.right);
+			addRow(other.bottom, other.left, other.right);
+		}
+	}
+
+	bool operator==(const CellBounds &other) const
+	{
+		return (empty() && other.empty()) || (left == other.left && top == other.top && right == other.right && bottom == other.bottom);
+	}
+	bool operator!=(const CellBounds &other) const { return !(*this == other); }
+};
+
+//Counts produced as a by-product of one generation step
+struct StepStats
+{
+	long long aliveCount = 0;	//alive cells after the step
+	long long survivors = 0;	//cells that were alive and stayed alive (what GameOfLife calls noStateChange)
+	uint64_t hashDelta = 0;		//XOR of zobristKey(y * width + x) of every cell that was born or died
+	CellBounds bounds;			//alive cells after the step
+
+	//cells that came alive, dying cells of Generations rules can't be born into so every other alive cell is new
+	long long births() const { return aliveCount - survivors; }
+
+	//alive cells that did not survive, aliveBefore is the alive count of the previous generation
+	long long deaths(long long aliveBefore) const { return aliveBefore - survivors; }
+};
+
+//Grows bounds over the alive cells (value 1) of row y, only call it for rows that have some
+template<class Cell>
+inline void addRowBounds(const Cell *row, int width, long long y, CellBounds &bounds)
+{
+	int first = 0;
+	while (first < width - 1 && row[first] != 1)
+	{
+		first++;
+	}
+	int last = width - 1;
+	while (last > first && row[last] != 1)
+	{
+		last--;
+	}
+	bounds.addRow(y, first, last);
+}
+
+//Base class of all alternative engines
+class LifeEngine
+{
+public:
+	virtual ~LifeEngine() {}
+
+	//short name used in prompts and output
+	virtual const char *name() const = 0;
+
+	//name with details such as the chosen kernel, for reporting
+	virtual std::string describe() const { return name(); }
+
+	//engine specific information about the last step, empty when there is none
+	virtual std::string stepReport() const { return std::string(); }
+
+	//copies width x height int board into the engine
+	virtual void load(const int *cells, int width, int height, int stride) = 0;
+
+	//copies the engines current board back into int board of the loaded size
+	virtual void store(int *cells, int stride) const = 0;
+
+	//sets what lies beyond the board edge, returns false when the engine can't do that mode
+	virtual bool setBoundary(Boundary boundary) { return boundary == Boundary::Dead; }
+
+	//sets the birth and survival rule, returns false when the engine can't run it
+	virtual bool setRule(const Rule &rule) { if (rule.isLife()) m_rule = rule; return rule.isLife(); }
+
+	const Rule &rule() const { return m_rule; }
+
+	//advances the board by one generation
+	virtual StepStats step() = 0;
+
+	//pool used by step, nullptr steps on the calling thread
+	void setThreadPool(ThreadPool *pool) { m_pool = pool; }
+
+protected:
+	//calls stepRows(firstRow, lastRow, stats) for bands covering rows 0..height-1 and returns the summed stats
+	template<class StepRows>
+	StepStats forEachBand(int height, StepRows stepRows);
+
+	ThreadPool *m_pool = nullptr;
+	Rule m_rule;
+
+private:
+	//stats of one band on its own cache line so threads don't share lines
+	struct alignas(64) BandStats
+	{
+		StepStats stats;
+	};
+	std::vector<BandStats> m_bandStats;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class StepRows>
+StepStats LifeEngine::forEachBand(int height, StepRows stepRows)
+{
+	const int minBandRows = 8; //smaller bands cost more in scheduling than they save
+
+	StepStats stats;
+	if (!m_pool || m_pool->threadCount() <= 1 || height < 2 * minBandRows)
+	{
+		stepRows(0, height, stats);
+		return stats;
+	}
+
+	//a few bands per thread leaves room for stealing when some bands are busier than others
+	int bands = (std::min)(height / minBandRows, m_pool->threadCount() * 4);
+	m_bandStats.assign(bands, BandStats());
+	m_pool->parallelFor(bands, [&](int band)
+	{
+		int firstRow = (int)((long long)height * band / bands);
+		int lastRow = (int)((long long)height * (band + 1) / bands);
+		stepRows(firstRow, lastRow, m_bandStats[band].stats);
+	});
+
+	for (const BandStats &band : m_bandStats)
+	{
+		stats.aliveCount += band.stats.aliveCount;
+		stats.survivors += band.stats.survivors;
+		stats.hashDelta ^= band.stats.hashDelta;
+		stats.bounds.add(band.stats.bounds);
+	}
+	return stats;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "LifeEngine.h"
+#include "BitBoard.h"
+
+/**
+	Packed board stepped 2x2 cells at a time through a table of every 4x4 neighbourhood.
+
+	The 16 cells around a 2x2 block decide its next generation, so a table of 65536 entries holds the next 2x2 block
+	of every 4x4 neighbourhood and a step is one lookup per 4 cells instead of counting the neighbours of each cell.
+	The index is four rows of four cells, 4 bits each from the packed rows y-1..y+2, bit 0 of a row is the cell left
+	of the block. An entry holds the cells x, x+1 of row y in bits 0 and 1 and of row y+1 in bits 2 and 3.
+
+	Tables of the common rules (the StaticRule types of withRule) are made by the compiler and sit in read only data,
+	other rules make theirs when they are set. A table is 64 KB, it lives in L2 and the part a board uses mostly in L1.
+	Building a table at compile time takes a few million constant evaluation steps, the MSVC projects raise
+	/constexpr:steps for it.
+*/
+
+//Next 2x2 block of every 4x4 neighbourhood under one rule
+struct BlockTable
+{
+	uint8_t next[65536] = {};
+};
+
+//alive cells of a 16 bit neighbourhood
+constexpr int popcount16(uint32_t bits)
+{
+	bits = bits - ((bits >> 1) & 0x5555);
+	bits = (bits & 0x3333) + ((bits >> 2) & 0x3333);
+	bits = (bits + (bits >> 4)) & 0x0F0F;
+	return (int)((bits + (bits >> 8)) & 0x1F);
+}
+
+//next 2x2 block of the 4x4 neighbourhood index under the birth and survive masks
+constexpr uint8_t blockNext(uint16_t birth, uint16_t survive, uint32_t index)
+{
+	uint8_t block = 0;
+	for (int cy = 1; cy <= 2; cy++)
+	{
+		for (int cx = 1; cx <= 2; cx++)
+		{
+			uint32_t self = 1u << (cy * 4 + cx);
+			int neighbours = popcount16(index & ((0x777u << ((cy - 1) * 4 + cx - 1)) & ~self));
+			int alive = (((index & self) ? survive : birth) >> neighbours) & 1;
+			block |= (uint8_t)(alive << ((cy - 1) * 2 + cx - 1));
+		}
+	}
+	return block;
+}
+
+constexpr BlockTable makeBlockTable(uint16_t birth, uint16_t survive)
+{
+	BlockTable table;
+	for (uint32_t index = 0; index < 65536; index++)
+	{
+		table.next[index] = blockNext(birth, survive, index);
+	}
+	return table;
+}
+
+//table of a StaticRule, made at compile time
+template<uint16_t Birth, uint16_t Survive>
+inline constexpr BlockTable g_blockTable = makeBlockTable(Birth, Survive);
+
+template<uint16_t Birth, uint16_t Survive>
+inline const uint8_t *staticBlockTable(const StaticRule<Birth, Survive> &) { return g_blockTable<Birth, Survive>.next; }
+
+//rules without a StaticRule have no compile time table
+inline const uint8_t *staticBlockTable(const Rule &) { return nullptr; }
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Computes block rows firstBlock..lastBlock-1 (rows 2 * block and 2 * block + 1) of the next generation of board
+//into next through table, stats as stepBitRow
+inline void stepBlockRows(const uint8_t *table, const BitBoard &board, BitBoard &next, int firstBlock, int lastBlock, StepStats &stats)
+{
+	int words = board.wordsPerRow();
+	int height = board.height();
+	const uint64_t *zero = board.zeroRow();
+	for (int block = firstBlock; block < lastBlock; block++)
+	{
+		int y = block * 2;
+		bool secondRow = y + 1 < height; //an odd height leaves the bottom block half outside
+		const uint64_t *rows[4] =
+		{
+			y > 0 ? board.row(y - 1) : zero,
+			board.row(y),
+			secondRow ? board.row(y + 1) : zero,
+			y + 2 < height ? board.row(y + 2) : zero
+		};
+		StepStats rowStats[2];
+		for (int w = 0; w < words; w++)
+		{
+			//cell x - 1 at bit 0 for the blocks at 0..60, the block at 62 takes its last cell from the next word
+			uint64_t shifted[4];
+			uint32_t lastIndex = 0;
+			for (int r = 0; r < 4; r++)
+			{
+				uint64_t word = rows[r][w];
+				shifted[r] = (word << 1) | (w > 0 ? rows[r][w - 1] >> 63 : 0);
+				uint64_t after = w + 1 < words ? rows[r][w + 1] & 1 : 0;
+				lastIndex |= (uint32_t)((word >> 61) | (after << 3)) << (r * 4);
+			}
+
+			uint64_t out[2] = { 0, 0 };
+			for (int x = 0; x < 62; x += 2)
+			{
+				uint32_t index = (uint32_t)((shifted[0] >> x) & 15) | (uint32_t)((shifted[1] >> x) & 15) << 4 |
+								 (uint32_t)((shifted[2] >> x) & 15) << 8 | (uint32_t)((shifted[3] >> x) & 15) << 12;
+				uint64_t cells = table[index];
+				out[0] |= (cells & 3) << x;
+				out[1] |= (cells >> 2) << x;
+			}
+			uint64_t cells = table[lastIndex];
+			out[0] |= (cells & 3) << 62;
+			out[1] |= (cells >> 2) << 62;
+
+			for (int r = 0; r < 2; r++)
+			{
+				if (r == 1 && !secondRow)
+				{
+					break;
+				}
+				if (w == words - 1)
+				{
+					out[r] &= board.lastMask();
+				}
+				uint64_t self = rows[r + 1][w];
+				next.row(y + r)[w] = out[r];
+				rowStats[r].aliveCount += popcount64(out[r]);
+				rowStats[r].survivors += popcount64(out[r] & self);
+				if (out[r] != self) //births and deaths
+				{
+					rowStats[r].hashDelta ^= zobristBits((uint64_t)(y + r) * board.width() + (uint64_t)w * 64, out[r] ^ self);
+				}
+			}
+		}
+
+		for (int r = 0; r < 2; r++)
+		{
+			stats.aliveCount += rowStats[r].aliveCount;
+			stats.survivors += rowStats[r].survivors;
+			stats.hashDelta ^= rowStats[r].hashDelta;
+			if (rowStats[r].aliveCount > 0)
+			{
+				addBitRowBounds(next.row(y + r), words, 0, y + r, stats.bounds);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Engine running the packed board through a block table, two boards are swapped every generation
+class LookupEngine : public LifeEngine
+{
+public:
+	LookupEngine() : m_table(g_blockTable<0x008, 0x00C>.next) {}
+
+	const char *name() const override { return "lookup"; }
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setRule(const Rule &rule) override;
+
+private:
+	BitBoard m_current;
+	BitBoard m_next;
+	const uint8_t *m_table;					//compile time table or m_ruleTable
+	std::vector<uint8_t> m_ruleTable;		//table of a rule without a compile time one
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void LookupEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_current.resize(width, height);
+	m_next.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (cells[y * stride + x] == 1)
+			{
+				m_current.set(x, y, true);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void LookupEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_current.height(); y++)
+	{
+		for (int x = 0; x < m_current.width(); x++)
+		{
+			cells[y * stride + x] = m_current.get(x, y);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool LookupEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	m_rule = rule;
+	m_table = withRule(rule, [](const auto &ruleType) { return staticBlockTable(ruleType); });
+	if (!m_table)
+	{
+		m_ruleTable.resize(65536);
+		for (uint32_t index = 0; index < 65536; index++)
+		{
+			m_ruleTable[index] = blockNext(rule.birth, rule.survive, index);
+		}
+		m_table = m_ruleTable.data();
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats LookupEngine::step()
+{
+	if (m_current.wordsPerRow() == 0) //empty board
+	{
+		return StepStats();
+	}
+	StepStats stats = forEachBand((m_current.height() + 1) / 2, [&](int firstBlock, int lastBlock, StepStats &bandStats)
+	{
+		stepBlockRows(m_table, m_current, m_next, firstBlock, lastBlock, bandStats);
+	});
+	m_current.swap(m_next);
+	return stats;
+}
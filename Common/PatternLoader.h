@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+	Streaming loader for RLE (.rle) and plaintext (.cells) Life patterns.
+
+	The file is read in fixed size blocks and parsed one character at a time, cells are handed to the caller as runs
+	(x, y, length, alive) the moment they are decoded. Nothing is built up in between, so a pattern of tens of millions
+	of cells is loaded in one pass with a few kilobytes of memory. The caller places and clips the runs, see
+	placeRun in the GameOfLife classes.
+
+	RLE: optional # comment lines, a header line "x = 10, y = 5, rule = B3/S23" and runs like "3o2b$2bo!".
+	'b' and '.' are dead cells, 'o' and other letters alive, '$' ends a row and '!' ends the pattern.
+	Plaintext: '!' comment lines, then one line per row with '.' for dead and 'O' or '*' for alive cells.
+	Only alive runs and dead runs between alive cells are reported, dead cells at the end of a row are skipped.
+*/
+
+enum class PatternFormat
+{
+	Auto,	//decided from the first line that is not a comment
+	Rle,
+	Cells
+};
+
+//What the loader found out about the pattern
+struct PatternInfo
+{
+	PatternFormat format = PatternFormat::Auto;
+	long long width = 0;	//from the RLE header, otherwise the widest row
+	long long height = 0;	//from the RLE header, otherwise the number of rows
+	long long aliveCells = 0;
+	std::string rule;		//rule from the RLE header, empty when there is none
+};
+
+//Buffered character source over a file or a string in memory
+class PatternSource
+{
+public:
+	explicit PatternSource(FILE *file) : m_file(file), m_text(nullptr), m_pos(0), m_end(0), m_buffer(1 << 16) {}
+	explicit PatternSource(const char *text) : m_file(nullptr), m_text(text), m_pos(0), m_end(strlen(text)) {}
+
+	//next character or EOF
+	int next()
+	{
+		if (m_pos == m_end && !refill())
+		{
+			return EOF;
+		}
+		return (unsigned char)(m_text ? m_text[m_pos++] : m_buffer[m_pos++]);
+	}
+
+	//next character without taking it
+	int peek()
+	{
+		if (m_pos == m_end && !refill())
+		{
+			return EOF;
+		}
+		return (unsigned char)(m_text ? m_text[m_pos] : m_buffer[m_pos]);
+	}
+
+	//skips the rest of the line including the line change
+	void skipLine()
+	{
+		int c = next();
+		while (c != EOF && c != '\n')
+		{
+			c = next();
+		}
+	}
+
+private:
+	bool refill()
+	{
+		if (!m_file)
+		{
+			return false;
+		}
+		m_end = fread(m_buffer.data(), 1, m_buffer.size(), m_file);
+		m_pos = 0;
+		return m_end > 0;
+	}
+
+	FILE *m_file;
+	const char *m_text;
+	size_t m_pos;
+	size_t m_end;
+	std::vector<char> m_buffer;	//block of the file
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Parses "x = 10, y = 5, rule = B3/S23" after the x has been read
+inline void parseRleHeader(PatternSource &source, PatternInfo &info)
+{
+	char key = 'x';
+	while (true)
+	{
+		int c = source.next();
+		while (c == ' ' || c == '\t' || c == '=')
+		{
+			c = source.next();
+		}
+
+		if (key == 'x' || key == 'y')
+		{
+			long long value = 0;
+			while (c >= '0' && c <= '9')
+			{
+				value = value * 10 + (c - '0');
+				c = source.next();
+			}
+			(key == 'x' ? info.width : info.height) = value;
+		}
+		else //rule, up to the end of the line
+		{
+			while (c != EOF && c != '\n' && c != '\r' && c != ',')
+			{
+				if (c != ' ')
+				{
+					info.rule += (char)c;
+				}
+				c = source.next();
+			}
+		}
+
+		//next key after the comma
+		while (c == ' ' || c == '\t' || c == '\r')
+		{
+			c = source.next();
+		}
+		if (c != ',')
+		{
+			if (c != '\n' && c != EOF)
+			{
+				source.skipLine();
+			}
+			return;
+		}
+		c = source.next();
+		while (c == ' ' || c == '\t')
+		{
+			c = source.next();
+		}
+		key = (char)c;
+		while (c != EOF && c != '=' && c != '\n') //rest of the key name
+		{
+			c = source.next();
+		}
+		if (c != '=')
+		{
+			return;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Reads the pattern from source and calls run(x, y, length, alive) for every decoded run, x and y include the offset.
+//Returns false with a message in error when the pattern is broken.
+template<class Run>
+bool loadPattern(PatternSource &source, PatternFormat format, long long offsetX, long long offsetY, Run run, PatternInfo &info, std::string &error)
+{
+	info = PatternInfo();
+
+	//comment lines before the cells also tell the format
+	int c = source.peek();
+	while (c == '#' || c == '!' || c == '\r' || c == '\n')
+	{
+		if (format == PatternFormat::Auto && c != '\r' && c != '\n')
+		{
+			format = (c == '#') ? PatternFormat::Rle : PatternFormat::Cells;
+		}
+		source.skipLine();
+		c = source.peek();
+	}
+
+	if (c == 'x') //rle header
+	{
+		format = PatternFormat::Rle;
+		source.next();
+		parseRleHeader(source, info);
+	}
+	if (format == PatternFormat::Auto)
+	{
+		format = (c == '.' || c == 'O' || c == '*') ? PatternFormat::Cells : PatternFormat::Rle;
+	}
+	info.format = format;
+
+	long long x = 0;
+	long long y = 0;
+	long long width = 0;
+	long long dead = 0; //dead cells not reported yet, they only matter when an alive cell follows on the row
+
+	if (format == PatternFormat::Cells)
+	{
+		for (c = source.next(); c != EOF; c = source.next())
+		{
+			if (c == '\n')
+			{
+				width = x > width ? x : width;
+				x = 0;
+				dead = 0;
+				y++;
+				if (source.peek() == '!') //comment between rows
+				{
+					source.skipLine();
+				}
+			}
+			else if (c == 'O' || c == '*')
+			{
+				long long length = 1;
+				while (source.peek() == c)
+				{
+					source.next();
+					length++;
+				}
+				if (dead > 0)
+				{
+					run(offsetX + x - dead, offsetY + y, dead, false);
+					dead = 0;
+				}
+				run(offsetX + x, offsetY + y, length, true);
+				info.aliveCells += length;
+				x += length;
+			}
+			else if (c != '\r')
+			{
+				dead++;
+				x++;
+			}
+		}
+		if (x > 0) //last row without line change
+		{
+			width = x > width ? x : width;
+			y++;
+		}
+		info.width = width;
+		info.height = y;
+		return true;
+	}
+
+	long long count = 0; //run count in front of a tag, 0 means 1
+	for (c = source.next(); c != EOF && c != '!'; c = source.next())
+	{
+		if (c >= '0' && c <= '9')
+		{
+			count = count * 10 + (c - '0');
+			continue;
+		}
+
+		long long length = count > 0 ? count : 1;
+		count = 0;
+		if (c == '$')
+		{
+			width = x > width ? x : width;
+			x = 0;
+			dead = 0;
+			y += length;
+		}
+		else if (c == 'b' || c == '.')
+		{
+			dead += length;
+			x += length;
+		}
+		else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+		{
+			if (dead > 0)
+			{
+				run(offsetX + x - dead, offsetY + y, dead, false);
+				dead = 0;
+			}
+			run(offsetX + x, offsetY + y, length, true);
+			info.aliveCells += length;
+			x += length;
+		}
+		else if (c == '#') //comment inside the cells
+		{
+			source.skipLine();
+		}
+		else if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+		{
+			error = std::string("unexpected character '") + (char)c + "' in rle cells";
+			return false;
+		}
+	}
+
+	width = x > width ? x : width;
+	if (info.width == 0)
+	{
+		info.width = width;
+	}
+	if (info.height == 0)
+	{
+		info.height = y + (x > 0 ? 1 : 0);
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Opens and loads a pattern file, format is taken from the contents
+template<class Run>
+bool loadPatternFile(const std::string &path, long long offsetX, long long offsetY, Run run, PatternInfo &info, std::string &error)
+{
+#ifdef _MSC_VER
+	FILE *file = nullptr;
+	fopen_s(&file, path.c_str(), "rb");
+#else
+	FILE *file = fopen(path.c_str(), "rb");
+#endif
+	if (!file)
+	{
+		error = "can't open " + path;
+		return false;
+	}
+	PatternSource source(file);
+	bool ok = loadPattern(source, PatternFormat::Auto, offsetX, offsetY, run, info, error);
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include "Zobrist.h"
+
+/**
+	Time spent in each phase of a generation (step, statistics, snapshot, render, input, sleep, export) as latency
+	histograms.
+
+	A PhaseScope reads the monotonic clock when it starts and ends and adds the time to the histogram of its phase,
+	that is two clock reads and a few uncontended atomic adds per phase and generation, cheap enough to stay on.
+	Histograms are log-linear like HDR histograms: times below 32 ns have a bucket each, above that every power of two
+	is split into 16 buckets, so a percentile is off by at most 1/16 of its value and a histogram is a fixed 8 KB from
+	nanoseconds to centuries. Counts are atomic, the render and frame writer threads record into the same timer as the
+	game thread.
+
+	The report gives count, p50, p99, max and total of every phase that ran. It is printed when the game ends and when
+	a report signal comes in (SIGUSR1, on Windows Ctrl+Break), a signal only sets a flag and the game loop prints at the
+	next generation. SIGINT and SIGTERM ask the loops to stop so the report is printed on the way out, a second one
+	ends the program at once.
+*/
+
+enum class Phase
+{
+	Step,			//engine step, including the reference comparison when verifying
+	Statistics,		//hash, cycle detection and statistics stream
+	Snapshot,		//copying the board for the render thread
+	Render,			//writing the board to the console
+	Input,			//waiting for the user between generations
+	Sleep,			//delay between generations in auto mode
+	Export,			//encoding and writing a frame image, on the writer thread
+	Count
+};
+
+inline const char *phaseName(Phase phase)
+{
+	static const char *names[] = { "step", "statistics", "snapshot", "render", "input", "sleep", "export" };
+	return names[(int)phase];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class LatencyHistogram
+{
+public:
+	static const int EXACT = 32;		//values below have a bucket each
+	static const int SUB_BITS = 4;		//buckets per power of two are 1 << SUB_BITS
+	static const int BUCKETS = EXACT + (64 - 5) * (1 << SUB_BITS);
+
+	LatencyHistogram() { reset(); }
+
+	void reset();
+
+	void record(uint64_t nanoseconds);
+
+	long long count() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t total() const { return m_total.load(std::memory_order_relaxed); }
+	uint64_t maxValue() const { return m_max.load(std::memory_order_relaxed); }
+
+	//smallest value that fraction (0 - 1) of the recorded values are at or below, as the top of its bucket
+	uint64_t percentile(double fraction) const;
+
+private:
+	static int bucketOf(uint64_t value);
+
+	//largest value that falls into bucket
+	static uint64_t bucketTop(int bucket);
+
+	std::atomic<uint64_t> m_buckets[BUCKETS];
+	std::atomic<long long> m_count;
+	std::atomic<uint64_t> m_total;
+	std::atomic<uint64_t> m_max;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void LatencyHistogram::reset()
+{
+	for (std::atomic<uint64_t> &bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count = 0;
+	m_total = 0;
+	m_max = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int LatencyHistogram::bucketOf(uint64_t value)
+{
+	if (value < EXACT)
+	{
+		return (int)value;
+	}
+	int top = highestBit64(value); //5 or more
+	int sub = (int)(value >> (top - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+	return EXACT + (top - 5) * (1 << SUB_BITS) + sub;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t LatencyHistogram::bucketTop(int bucket)
+{
+	if (bucket < EXACT)
+	{
+		return (uint64_t)bucket;
+	}
+	int top = (bucket - EXACT) / (1 << SUB_BITS) + 5;
+	uint64_t sub = (uint64_t)((bucket - EXACT) % (1 << SUB_BITS));
+	uint64_t width = (uint64_t)1 << (top - SUB_BITS);
+	return (((uint64_t)1 << SUB_BITS) + sub) * width + (width - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void LatencyHistogram::record(uint64_t nanoseconds)
+{
+	m_buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_total.fetch_add(nanoseconds, std::memory_order_relaxed);
+	uint64_t max = m_max.load(std::memory_order_relaxed);
+	while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t LatencyHistogram::percentile(double fraction) const
+{
+	long long count = this->count();
+	if (count == 0)
+	{
+		return 0;
+	}
+	long long rank = (long long)(fraction * count + 0.5);
+	rank = rank < 1 ? 1 : rank > count ? count : rank;
+	long long seen = 0;
+	for (int bucket = 0; bucket < BUCKETS; bucket++)
+	{
+		seen += (long long)m_buckets[bucket].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			uint64_t top = bucketTop(bucket);
+			return top < maxValue() ? top : maxValue();
+		}
+	}
+	return maxValue();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Histogram of every phase
+class PhaseTimer
+{
+public:
+	void record(Phase phase, uint64_t nanoseconds) { m_phases[(int)phase].record(nanoseconds); }
+
+	const LatencyHistogram &histogram(Phase phase) const { return m_phases[(int)phase]; }
+
+	void reset();
+
+	//table of the phases that ran, one line each
+	void report(std::ostream &out) const;
+
+private:
+	LatencyHistogram m_phases[(int)Phase::Count];
+};
+
+//timer of the program, shared by the game and the render thread
+inline PhaseTimer g_phaseTimer;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void PhaseTimer::reset()
+{
+	for (LatencyHistogram &histogram : m_phases)
+	{
+		histogram.reset();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//nanoseconds as a short text with a unit, 3 significant digits
+inline std::string formatNanoseconds(uint64_t nanoseconds)
+{
+	char text[32];
+	if (nanoseconds < 1000)
+		snprintf(text, sizeof(text), "%llu ns", (unsigned long long)nanoseconds);
+	else if (nanoseconds < 1000000)
+		snprintf(text, sizeof(text), "%.3g us", nanoseconds / 1e3);
+	else if (nanoseconds < 1000000000)
+		snprintf(text, sizeof(text), "%.3g ms", nanoseconds / 1e6);
+	else
+		snprintf(text, sizeof(text), "%.3g s", nanoseconds / 1e9);
+	return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void PhaseTimer::report(std::ostream &out) const
+{
+	char line[128];
+	snprintf(line, sizeof(line), "%-11s %10s %10s %10s %10s %10s", "Phase", "count", "p50", "p99", "max", "total");
+	out << line << '\n';
+	for (int phase = 0; phase < (int)Phase::Count; phase++)
+	{
+		const LatencyHistogram &histogram = m_phases[phase];
+		if (histogram.count() == 0)
+		{
+			continue;
+		}
+		snprintf(line, sizeof(line), "%-11s %10lld %10s %10s %10s %10s", phaseName((Phase)phase), histogram.count(),
+				 formatNanoseconds(histogram.percentile(0.5)).c_str(), formatNanoseconds(histogram.percentile(0.99)).c_str(),
+				 formatNanoseconds(histogram.maxValue()).c_str(), formatNanoseconds(histogram.total()).c_str());
+		out << line << '\n';
+	}
+	out.flush();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//nanoseconds from start until now on the monotonic clock
+inline uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Times its own lifetime into a phase of g_phaseTimer
+class PhaseScope
+{
+public:
+	explicit PhaseScope(Phase phase) : m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+	~PhaseScope() { g_phaseTimer.record(m_phase, nanosecondsSince(m_start)); }
+
+	PhaseScope(const PhaseScope &) = delete;
+	PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+	Phase m_phase;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//set by the signal handlers, read by the game loop
+inline volatile std::sig_atomic_t g_reportRequested = 0;
+inline volatile std::sig_atomic_t g_stopRequested = 0;
+
+extern "C" inline void onReportSignal(int signal)
+{
+	g_reportRequested = 1;
+	std::signal(signal, onReportSignal); //some systems reset the handler on delivery
+}
+
+extern "C" inline void onStopSignal(int signal)
+{
+	g_stopRequested = 1;
+	std::signal(signal, SIG_DFL); //the next one ends the program
+}
+
+//installs the report and stop signal handlers
+inline void installPhaseSignals()
+{
+#ifdef _WIN32
+	std::signal(SIGBREAK, onReportSignal);
+#else
+	std::signal(SIGUSR1, onReportSignal);
+#endif
+	std::signal(SIGINT, onStopSignal);
+	std::signal(SIGTERM, onStopSignal);
+}
+
+//true once SIGINT or SIGTERM came in, loops stop at the next generation
+inline bool stopRequested() { return g_stopRequested != 0; }
+
+//prints the report when a report signal came in since the last call
+inline void pollPhaseReport(std::ostream &out)
+{
+	if (g_reportRequested)
+	{
+		g_reportRequested = 0;
+		g_phaseTimer.report(out);
+	}
+}
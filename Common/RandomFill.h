@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+#include "Zobrist.h"
+
+/**
+	Random boards from a seed, 64 cells per draw, the same board for a seed whatever the number of threads.
+
+	Numbers come from xoshiro256**, four words of state and a few shifts and multiplies per 64 random bits. Every row
+	of the board has its own generator, seeded from the board seed and the row number, so rows can be made in any order
+	on any thread and a row of a huge board doesn't need the rows above it.
+
+	A cell is alive with chance threshold / 65536, threshold is the fill percent rounded to 16 bits. 64 cells are made
+	at once by combining random words bit by bit of the threshold, lowest bit first: a 1 bit ORs in a new word, a 0 bit
+	ANDs it, which halves the chance and adds 1/2 for the bits that are set. That is one draw per 64 cells at 50 %,
+	two at 25 % or 75 % and at most 16 for any fill.
+*/
+
+class Xoshiro256
+{
+public:
+	//generator of stream number stream of seed, the state is spread from both with splitmix64
+	Xoshiro256(uint64_t seed, uint64_t stream)
+	{
+		uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+		for (uint64_t &word : m_state)
+		{
+			word = zobristKey(x); //splitmix64 finalizer, never gives four zero words in a row
+			x += 0x9E3779B97F4A7C15ULL;
+		}
+	}
+
+	uint64_t next()
+	{
+		uint64_t result = rotate(m_state[1] * 5, 7) * 9;
+		uint64_t t = m_state[1] << 17;
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = rotate(m_state[3], 45);
+		return result;
+	}
+
+private:
+	static uint64_t rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+	uint64_t m_state[4];
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//chance in 1/65536 that a cell is alive at fillPercent (0 - 100)
+inline uint32_t fillThreshold(int fillPercent)
+{
+	return (uint32_t)((fillPercent * 65536 + 50) / 100);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//64 cells, each alive with chance threshold / 65536
+inline uint64_t randomCells(Xoshiro256 &random, uint32_t threshold)
+{
+	if (threshold == 0)
+	{
+		return 0;
+	}
+	if (threshold >= 65536)
+	{
+		return ~0ULL;
+	}
+	int bit = lowestBit64(threshold); //lower 0 bits would AND into an empty word
+	uint64_t cells = random.next();
+	for (bit++; bit < 16; bit++)
+	{
+		cells = ((threshold >> bit) & 1) ? cells | random.next() : cells & random.next();
+	}
+	return cells;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//fills the (width + 63) / 64 words of row y of the board of seed, bits past width are cleared
+inline void randomBitRow(uint64_t seed, uint64_t y, uint32_t threshold, uint64_t width, uint64_t *words)
+{
+	Xoshiro256 random(seed, y);
+	uint64_t count = (width + 63) / 64;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		words[i] = randomCells(random, threshold);
+	}
+	if (width % 64)
+	{
+		words[count - 1] &= ((uint64_t)1 << (width % 64)) - 1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//makes the rows of the board of seed on pool (nullptr makes them on the calling thread) and calls rowDone(y, words)
+//for each, from the thread that made it, rows never share a call so rowDone may write its row without locking
+template<class RowDone>
+void randomBitBoard(uint64_t seed, int fillPercent, int width, int height, ThreadPool *pool, RowDone rowDone)
+{
+	const int BLOCK_ROWS = 16;
+	uint32_t threshold = fillThreshold(fillPercent);
+	int threads = pool ? pool->threadCount() : 1;
+	std::vector<std::vector<uint64_t>> rows(threads, std::vector<uint64_t>(((size_t)width + 63) / 64));
+
+	auto makeBlock = [&](int block, int thread)
+	{
+		uint64_t *words = rows[thread].data();
+		for (int y = block * BLOCK_ROWS; y < height && y < (block + 1) * BLOCK_ROWS; y++)
+		{
+			randomBitRow(seed, y, threshold, width, words);
+			rowDone(y, (const uint64_t *)words);
+		}
+	};
+
+	int blocks = (height + BLOCK_ROWS - 1) / BLOCK_ROWS;
+	if (pool)
+	{
+		pool->parallelFor(blocks, makeBlock);
+	}
+	else
+	{
+		for (int block = 0; block < blocks; block++)
+		{
+			makeBlock(block, 0);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//XOR of the Zobrist keys of the set bits of count words of row y, width is the board width
+inline uint64_t bitRowHash(const uint64_t *words, uint64_t count, uint64_t y, uint64_t width)
+{
+	uint64_t hash = 0;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		for (uint64_t bits = words[i]; bits; bits &= bits - 1)
+		{
+			hash ^= zobristKey(y * width + i * 64 + lowestBit64(bits));
+		}
+	}
+	return hash;
+}
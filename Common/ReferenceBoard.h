@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "LifeEngine.h"
+#include "HaloGrid.h"
+
+/**
+	The original int loop of GameOfLife::onUpdate as an engine, the baseline every other engine is measured against.
+
+	Cells are ints in a HaloGrid, every cell reads its eight neighbours one by one and the rule gives its next state.
+	It runs every rule and every boundary but infinite, always on the calling thread. GameOfLife verifies the other
+	engines by running stepReferenceGrid on its own board.
+*/
+
+//one generation of grid with the original int loop, the next generation is written into the other buffer of grid
+inline StepStats stepReferenceGrid(HaloGrid<int> &grid, const Rule &rule)
+{
+	//State change counter
+	long long noStateChange = 0;
+
+	//value for checking when there's no changes in alive count --> game is still or dead
+	long long aliveCountNew = 0;
+
+	//hash change of the births and deaths
+	uint64_t hashDelta = 0;
+
+	//box around the alive cells
+	CellBounds bounds;
+
+	//ghost border makes reads outside of the board safe, its cells follow the boundary mode
+	grid.fillHalo();
+	const int width = grid.width();
+	const int height = grid.height();
+	const int *current = grid.row(0);
+	int *next = grid.nextRow(0);
+	const int stride = grid.stride();
+
+	//lambda function to return whether the cell on x y coordinates is alive in current generation (1 or 0), dying cells of Generations rules are not
+	auto cell = [&](int x, int y)
+	{
+		return (int)(current[(ptrdiff_t)y * stride + x] == 1);
+	};
+
+	//nested for loop to go through all cells, row by row so the reads follow memory
+	for (int y = 0; y < height; y++)
+	{
+		const int *row = current + (ptrdiff_t)y * stride;
+		int *out = next + (ptrdiff_t)y * stride;
+		int rowFirst = -1, rowLast = -1; //alive cells of the new row
+		for (int x = 0; x < width; x++)
+		{
+			/*						Neighbours of one cell
+
+								x-1 y-1		X-0 y-1			X+1 y-1
+								X-1 y-0	   this cell		X+1 y+0
+								X-1	y+1		X+0 y+1			X+1 y+1
+			*/
+			int nNeighbours = cell(x - 1, y - 1) + cell(x - 0, y - 1) + cell(x + 1, y - 1) +
+							  cell(x - 1, y + 0) +			0		  +	cell(x + 1, y + 0) +
+							  cell(x - 1, y + 1) + cell(x + 0, y + 1) + cell(x + 1, y + 1);
+
+			int state = row[x];
+			int nextState = rule.nextState(state, nNeighbours); //born, survives, starts dying or decays
+			out[x] = nextState;
+
+			//one check of the new state counts the alive cells, the ones that stayed alive and the ends of the row
+			if (nextState == 1)
+			{
+				aliveCountNew++; //get amount of current alive cells
+				noStateChange += state == 1; //check for when no state changes for oscillators and movers
+				rowLast = x;
+				rowFirst = rowFirst < 0 ? x : rowFirst;
+			}
+
+			if (nextState != state)
+			{
+				uint64_t index = (uint64_t)y * width + x;
+				hashDelta ^= (state ? zobristStateKey(index, state) : 0) ^ (nextState ? zobristStateKey(index, nextState) : 0); //old state out, new state in
+			}
+		}
+		if (rowFirst >= 0)
+		{
+			bounds.addRow(y, rowFirst, rowLast);
+		}
+	}
+
+	grid.swap(); //next generation becomes current, no copying
+
+	StepStats stats;
+	stats.aliveCount = aliveCountNew;
+	stats.survivors = noStateChange;
+	stats.hashDelta = hashDelta;
+	stats.bounds = bounds;
+	return stats;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Engine running the original int loop, single threaded whatever pool is set
+class ReferenceEngine : public LifeEngine
+{
+public:
+	const char *name() const override { return "reference"; }
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override { return stepReferenceGrid(m_grid, m_rule); }
+	bool setBoundary(Boundary boundary) override { m_grid.setBoundary(boundary); return boundary != Boundary::Infinite; }
+	bool setRule(const Rule &rule) override { m_rule = rule; return true; }
+
+private:
+	HaloGrid<int> m_grid;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ReferenceEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_grid.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		int *row = m_grid.row(y);
+		for (int x = 0; x < width; x++)
+		{
+			int state = cells[y * stride + x];
+			row[x] = state > 0 && state < m_rule.states ? state : 0;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ReferenceEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_grid.height(); y++)
+	{
+		const int *row = m_grid.row(y);
+		for (int x = 0; x < m_grid.width(); x++)
+		{
+			cells[y * stride + x] = row[x];
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ConsoleRenderer.h"
+#include "PhaseTimer.h"
+#include "TripleBuffer.h"
+
+/**
+	Draws snapshots of the board on its own thread at a fixed display rate.
+
+	The simulation fills frame() and calls publish(), the render thread wakes up fps times a second and draws the
+	newest published snapshot with a ConsoleRenderer. Snapshots published in between are dropped, so the simulation
+	runs at full speed whatever the console costs. wantsFrame tells the simulation when a snapshot is worth taking,
+	copying every generation of a large board would cost more than stepping it.
+*/
+
+//Board and header lines as they are drawn
+struct Snapshot
+{
+	std::vector<int> cells;				//width x height, rows are width apart
+	int width = 0;
+	int height = 0;
+	std::vector<std::string> header;
+};
+
+class RenderThread
+{
+public:
+	explicit RenderThread(int fps = 30);
+	~RenderThread() { stop(); }
+
+	RenderThread(const RenderThread &) = delete;
+	RenderThread &operator=(const RenderThread &) = delete;
+
+	//starts drawing, first frame clears the screen
+	void start();
+
+	//draws the last published snapshot and joins the thread
+	void stop();
+
+	//snapshot the simulation fills, only the simulation thread may touch it
+	Snapshot &frame() { return m_buffer.writeSlot(); }
+
+	//hands frame() over to the render thread
+	void publish();
+
+	//true when a quarter of a display period has passed since the last publish
+	bool wantsFrame() const { return std::chrono::steady_clock::now() - m_lastPublish >= m_period / 4; }
+
+	//number of snapshots drawn so far
+	long long framesDrawn() const { return m_framesDrawn; }
+
+private:
+	void renderLoop();
+
+	//draws the newest snapshot if there is one
+	void drawLatest();
+
+	TripleBuffer<Snapshot> m_buffer;
+	ConsoleRenderer m_renderer;
+	std::chrono::steady_clock::duration m_period;
+	std::chrono::steady_clock::time_point m_lastPublish;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	std::atomic<long long> m_framesDrawn;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline RenderThread::RenderThread(int fps) : m_stop(false), m_framesDrawn(0)
+{
+	m_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / (fps > 0 ? fps : 30)));
+	m_lastPublish = std::chrono::steady_clock::time_point();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void RenderThread::start()
+{
+	if (m_thread.joinable())
+	{
+		return;
+	}
+	m_stop = false;
+	m_renderer.invalidate();
+	m_thread = std::thread(&RenderThread::renderLoop, this);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void RenderThread::stop()
+{
+	if (!m_thread.joinable())
+	{
+		return;
+	}
+	m_stop = true;
+	m_thread.join();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void RenderThread::publish()
+{
+	m_buffer.publish();
+	m_lastPublish = std::chrono::steady_clock::now();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void RenderThread::renderLoop()
+{
+	auto next = std::chrono::steady_clock::now();
+	while (!m_stop)
+	{
+		drawLatest();
+		next += m_period;
+		if (next < std::chrono::steady_clock::now()) //slow console, don't try to catch up
+		{
+			next = std::chrono::steady_clock::now();
+		}
+		std::this_thread::sleep_until(next);
+	}
+	drawLatest(); //final board of the run
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void RenderThread::drawLatest()
+{
+	if (!m_buffer.acquire())
+	{
+		return;
+	}
+	PhaseScope phase(Phase::Render);
+	const Snapshot &snapshot = m_buffer.readSlot();
+	m_renderer.render(snapshot.cells.data(), snapshot.width, snapshot.height, snapshot.width, snapshot.header);
+	m_framesDrawn++;
+}
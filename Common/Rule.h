@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+	Life-like rules in B/S notation, B3/S23 is Conway's Game of Life.
+
+	A rule is two masks over the neighbour count 0-8: bit n of birth is set when a dead cell with n alive neighbours
+	comes alive, bit n of survive when an alive cell with n neighbours stays alive. The masks are the lookup table,
+	kernels turn them into their own form once (a shift in a register, a pshufb table, an adder circuit) and the
+	hot loops carry no branches on the rule.
+
+	Common rules also exist as StaticRule types. Kernels are templates over the rule type, with a StaticRule the masks
+	are compile time constants and the compiler folds them into the kernel, with a Rule they are read at run time.
+	withRule calls a generic function with the StaticRule of a common rule or with the Rule itself.
+
+	Rules with B0 are refused: an empty area would come alive every generation, which no engine here can represent.
+
+	Generations rules (B2/S/C3 is Brian's Brain) have more than two states: 0 is dead, 1 alive and 2..states-1 are
+	dying. An alive cell that does not survive starts dying and a dying cell moves one state on every generation
+	until it is dead again. Only alive cells count as neighbours and dying cells can't be born into.
+*/
+
+struct Rule
+{
+	uint16_t birth = 1 << 3;
+	uint16_t survive = (1 << 2) | (1 << 3);
+	int states = 2;				//number of cell states, more than 2 for Generations rules
+
+	static const int MAX_STATES = 256;	//states fit in a byte
+
+	Rule() {}
+	Rule(uint16_t birthMask, uint16_t surviveMask, int stateCount = 2) : birth(birthMask), survive(surviveMask), states(stateCount) {}
+
+	//state of a two state cell in the next generation
+	int next(int alive, int nNeighbours) const { return ((alive ? survive : birth) >> nNeighbours) & 1; }
+
+	//state of a cell of any state in the next generation, nNeighbours counts alive (state 1) neighbours only
+	int nextState(int state, int nNeighbours) const
+	{
+		if (state == 0)
+			return (birth >> nNeighbours) & 1;
+		if (state == 1 && ((survive >> nNeighbours) & 1))
+			return 1;
+		return state + 1 < states ? state + 1 : 0; //starts or keeps dying
+	}
+
+	bool isLife() const { return birth == Rule().birth && survive == Rule().survive && states == 2; }
+
+	bool operator==(const Rule &other) const { return birth == other.birth && survive == other.survive && states == other.states; }
+	bool operator!=(const Rule &other) const { return !(*this == other); }
+};
+
+//Rule fixed at compile time, the kernel sees the masks as constants
+template<uint16_t Birth, uint16_t Survive>
+struct StaticRule
+{
+	static constexpr uint16_t birth = Birth;
+	static constexpr uint16_t survive = Survive;
+	static constexpr int states = 2;
+
+	StaticRule() {}
+	explicit StaticRule(const Rule &) {} //kernels construct their rule type from the run time Rule
+};
+
+//Rules with a name
+struct NamedRule
+{
+	const char *name;
+	const char *rulestring;
+};
+
+inline const NamedRule g_namedRules[] =
+{
+	{ "life", "B3/S23" },
+	{ "highlife", "B36/S23" },
+	{ "daynight", "B3678/S34678" },
+	{ "seeds", "B2/S" },
+	{ "lifewithoutdeath", "B3/S012345678" },
+	{ "maze", "B3/S12345" },
+	{ "replicator", "B1357/S1357" },
+	{ "2x2", "B36/S125" },
+	{ "diamoeba", "B35678/S5678" },
+	{ "morley", "B368/S245" },
+	{ "briansbrain", "B2/S/C3" },
+	{ "starwars", "B2/S345/C4" },
+	{ "brainsix", "B246/S6/C3" },
+	{ "frogs", "B34/S12/C3" },
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Canonical rulestring, B3/S23 or B2/S/C3
+inline std::string ruleString(const Rule &rule)
+{
+	std::string s = "B";
+	for (int n = 0; n <= 8; n++)
+	{
+		if ((rule.birth >> n) & 1)
+			s += (char)('0' + n);
+	}
+	s += "/S";
+	for (int n = 0; n <= 8; n++)
+	{
+		if ((rule.survive >> n) & 1)
+			s += (char)('0' + n);
+	}
+	if (rule.states > 2)
+	{
+		s += "/C" + std::to_string(rule.states);
+	}
+	return s;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//comma separated list of rule names for prompts
+inline std::string ruleNames()
+{
+	std::string list;
+	for (const NamedRule &named : g_namedRules)
+	{
+		if (!list.empty())
+			list += ", ";
+		list += named.name;
+	}
+	return list;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Reads digits 0-8 into mask until a character that is not a digit, returns position after them or npos on a bad digit
+inline size_t parseRuleDigits(const std::string &s, size_t pos, uint16_t &mask)
+{
+	mask = 0;
+	for (; pos < s.size() && s[pos] >= '0' && s[pos] <= '9'; pos++)
+	{
+		if (s[pos] == '9')
+		{
+			return std::string::npos;
+		}
+		mask |= (uint16_t)(1 << (s[pos] - '0'));
+	}
+	return pos;
+}
+
+//Converts B3/S23, b3/s23, B3S23, S/B notation 23/3, Generations B2/S/C3 or 345/2/4 (S/B/C) or a name from g_namedRules
+//into rule, returns false when the string is not a rule or the rule can't be run
+inline bool parseRule(const std::string &s, Rule &rule)
+{
+	for (const NamedRule &named : g_namedRules)
+	{
+		if (s == named.name)
+		{
+			return parseRule(named.rulestring, rule);
+		}
+	}
+	if (s.empty())
+	{
+		return false;
+	}
+
+	Rule parsed(0, 0);
+	size_t pos = 0;
+	if (s[0] == 'B' || s[0] == 'b')
+	{
+		pos = parseRuleDigits(s, 1, parsed.birth);
+		if (pos < s.size() && s[pos] == '/')
+		{
+			pos++;
+		}
+		if (pos >= s.size() || (s[pos] != 'S' && s[pos] != 's'))
+		{
+			return false;
+		}
+		pos = parseRuleDigits(s, pos + 1, parsed.survive);
+	}
+	else //S/B notation
+	{
+		pos = parseRuleDigits(s, 0, parsed.survive);
+		if (pos >= s.size() || s[pos] != '/')
+		{
+			return false;
+		}
+		pos = parseRuleDigits(s, pos + 1, parsed.birth);
+	}
+
+	//number of states, /C3 after B/S and /3 after S/B
+	if (pos < s.size() && s[pos] == '/')
+	{
+		pos++;
+		if (pos < s.size() && (s[pos] == 'C' || s[pos] == 'c' || s[pos] == 'G' || s[pos] == 'g'))
+		{
+			pos++;
+		}
+		size_t end = pos;
+		int states = 0;
+		while (end < s.size() && s[end] >= '0' && s[end] <= '9' && states <= Rule::MAX_STATES)
+		{
+			states = states * 10 + (s[end] - '0');
+			end++;
+		}
+		if (end == pos || states < 2 || states > Rule::MAX_STATES)
+		{
+			return false;
+		}
+		parsed.states = states;
+		pos = end;
+	}
+
+	if (pos != s.size() || (parsed.birth & 1))
+	{
+		return false;
+	}
+	rule = parsed;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Calls visit(StaticRule<...>()) when rule is one of the common two state rules and visit(rule) otherwise,
+//returns what visit returns
+template<class Visit>
+auto withRule(const Rule &rule, Visit visit) -> decltype(visit(rule))
+{
+	const uint16_t b = rule.birth;
+	const uint16_t s = rule.survive;
+	if (rule.states != 2)
+		return visit(rule);
+	if (b == 0x008 && s == 0x00C)
+		return visit(StaticRule<0x008, 0x00C>());	//B3/S23 life
+	if (b == 0x048 && s == 0x00C)
+		return visit(StaticRule<0x048, 0x00C>());	//B36/S23 highlife
+	if (b == 0x1C8 && s == 0x1D8)
+		return visit(StaticRule<0x1C8, 0x1D8>());	//B3678/S34678 day and night
+	if (b == 0x004 && s == 0x000)
+		return visit(StaticRule<0x004, 0x000>());	//B2/S seeds
+	return visit(rule);
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "BitBoard.h"
+#include "RandomFill.h"
+#include "ThreadPool.h"
+#include "Zobrist.h"
+
+/**
+	Runs many random boards ("soups") and collects how long they last before they repeat.
+
+	Soup i is the board GameOfLife::randomize makes with seed firstSeed + i, so any soup can be looked at again in the
+	game. A soup is stepped on a BitBoard until its hash repeats an earlier generation or maxGenerations have run.
+	Its lifetime is the generation the cycle starts at, what GameOfLife::getGenerations reports.
+
+	Soups are handed to the ThreadPool in blocks, a few per thread, and threads that finish early steal blocks from
+	the others, soups last very different times. Every thread has its own SoupWorker: two boards, a cycle detector and
+	its totals. They are sized by the first soup and reused, so running a soup allocates nothing and the totals of a
+	thread share no cache lines with the others.
+*/
+
+struct SoupOptions
+{
+	int width = 32;
+	int height = 32;
+	int fillPercent = 50;
+	unsigned int firstSeed = 1;
+	long long soups = 1000;
+	long long maxGenerations = 10000;	//soups still changing after this are counted as unsettled
+	Rule rule;							//two state rules only
+};
+
+//Aggregated results of soups
+struct SoupTotals
+{
+	static const int LIFETIME_BINS = 64;
+	static const int MAX_PERIOD = 16;	//longer periods share one counter
+
+	long long soups = 0;						//soups run
+	long long settled = 0;						//soups that ended in a cycle
+	long long lifetimes[LIFETIME_BINS] = {};	//settled soups by lifetime, bin 0 holds 0, bin b holds 2^(b-1) .. 2^b - 1
+	long long lifetimeSum = 0;
+	long long longestLifetime = -1;
+	unsigned int longestSeed = 0;				//seed of the longest lived soup
+	long long periods[MAX_PERIOD + 1] = {};		//settled soups by period, periods[0] counts the ones over MAX_PERIOD
+	long long populationSum = 0;				//alive cells at the end of the soups
+	long long populationMin = -1;
+	long long populationMax = 0;
+	long long generations = 0;					//generations stepped in all soups
+
+	static int lifetimeBin(long long lifetime) { return lifetime <= 0 ? 0 : highestBit64((uint64_t)lifetime) + 1; }
+
+	//adds the totals of other soups
+	void add(const SoupTotals &other);
+
+	//counts one soup
+	void addSoup(unsigned int seed, bool settled, long long lifetime, long long period, long long population, long long generations);
+};
+
+//Buffers of one thread, reused for every soup it runs
+struct alignas(64) SoupWorker
+{
+	BitBoard current;
+	BitBoard next;
+	CycleDetector cycles;
+	SoupTotals totals;
+};
+
+//runs the soups of options on pool (nullptr runs on the calling thread) and adds them to totals,
+//stop is polled between soups and ends the run early when it returns true
+template<class Stop>
+void runSoups(const SoupOptions &options, ThreadPool *pool, SoupTotals &totals, Stop stop);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void SoupTotals::add(const SoupTotals &other)
+{
+	soups += other.soups;
+	settled += other.settled;
+	for (int bin = 0; bin < LIFETIME_BINS; bin++)
+	{
+		lifetimes[bin] += other.lifetimes[bin];
+	}
+	lifetimeSum += other.lifetimeSum;
+	if (other.longestLifetime > longestLifetime || (other.longestLifetime == longestLifetime && other.longestSeed < longestSeed))
+	{
+		longestLifetime = other.longestLifetime;
+		longestSeed = other.longestSeed;
+	}
+	for (int period = 0; period <= MAX_PERIOD; period++)
+	{
+		periods[period] += other.periods[period];
+	}
+	populationSum += other.populationSum;
+	if (other.populationMin >= 0 && (populationMin < 0 || other.populationMin < populationMin))
+	{
+		populationMin = other.populationMin;
+	}
+	populationMax = (std::max)(populationMax, other.populationMax);
+	generations += other.generations;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void SoupTotals::addSoup(unsigned int seed, bool settledSoup, long long lifetime, long long period, long long population, long long steps)
+{
+	soups++;
+	generations += steps;
+	populationSum += population;
+	populationMin = populationMin < 0 || population < populationMin ? population : populationMin;
+	populationMax = (std::max)(populationMax, population);
+	if (!settledSoup)
+	{
+		return;
+	}
+	settled++;
+	lifetimes[lifetimeBin(lifetime)]++;
+	lifetimeSum += lifetime;
+	if (lifetime > longestLifetime || (lifetime == longestLifetime && seed < longestSeed))
+	{
+		longestLifetime = lifetime;
+		longestSeed = seed;
+	}
+	periods[period <= MAX_PERIOD ? period : 0]++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//runs one soup on the buffers of worker
+template<class RuleType>
+inline void runSoup(const RuleType &rule, const SoupOptions &options, unsigned int seed, SoupWorker &worker)
+{
+	BitBoard &current = worker.current;
+	BitBoard &next = worker.next;
+	if (current.width() != options.width || current.height() != options.height)
+	{
+		current.resize(options.width, options.height);
+		next.resize(options.width, options.height);
+	}
+
+	//same rows as GameOfLife::randomize, made straight into the board
+	uint32_t threshold = fillThreshold(options.fillPercent);
+	uint64_t hash = 0;
+	long long population = 0;
+	for (int y = 0; y < options.height; y++)
+	{
+		uint64_t *row = current.row(y);
+		randomBitRow(seed, y, threshold, options.width, row);
+		hash ^= bitRowHash(row, current.wordsPerRow(), y, options.width);
+		for (int i = 0; i < current.wordsPerRow(); i++)
+		{
+			population += popcount64(row[i]);
+		}
+	}
+
+	worker.cycles.reset();
+	worker.cycles.add(hash, 0);
+	long long generation = 0;
+	while (generation < options.maxGenerations && !worker.cycles.found())
+	{
+		StepStats stats;
+		current.stepRows(rule, next, 0, options.height, stats);
+		current.swap(next);
+		generation++;
+		hash ^= stats.hashDelta;
+		population = stats.aliveCount;
+		worker.cycles.add(hash, generation);
+	}
+	worker.totals.addSoup(seed, worker.cycles.found(), worker.cycles.cycleStart(), worker.cycles.period(), population, generation);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Stop>
+void runSoups(const SoupOptions &options, ThreadPool *pool, SoupTotals &totals, Stop stop)
+{
+	int threads = pool ? pool->threadCount() : 1;
+	std::vector<SoupWorker> workers(threads);
+
+	//blocks small enough to balance, big enough that taking one costs nothing next to its soups
+	long long block = (std::max)(1LL, options.soups / (threads * 64LL));
+	long long blocks = (options.soups + block - 1) / block;
+
+	auto runBlock = [&](int index, int thread)
+	{
+		SoupWorker &worker = workers[thread];
+		long long first = index * block;
+		long long last = (std::min)(first + block, options.soups);
+		withRule(options.rule, [&](const auto &rule)
+		{
+			for (long long soup = first; soup < last && !stop(); soup++)
+			{
+				runSoup(rule, options, (unsigned int)(options.firstSeed + soup), worker);
+			}
+		});
+	};
+
+	//block indices fit in an int, larger ensembles run in rounds
+	const long long ROUND = 1 << 30;
+	for (long long done = 0; done < blocks && !stop(); done += ROUND)
+	{
+		int count = (int)(std::min)(ROUND, blocks - done);
+		if (pool)
+		{
+			pool->parallelFor(count, [&](int index, int thread) { runBlock((int)(done + index), thread); });
+		}
+		else
+		{
+			for (int index = 0; index < count; index++)
+			{
+				runBlock((int)(done + index), 0);
+			}
+		}
+	}
+
+	for (const SoupWorker &worker : workers)
+	{
+		totals.add(worker.totals);
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LifeEngine.h"
+
+/**
+	Time series of statistics of every generation, written while the game runs.
+
+	A record is made from the StepStats of a step, which the engines fill as a by-product of computing it (see
+	LifeEngine.h), so the stream never looks at the board. Records are collected in a large stdio buffer and reach the
+	file in big writes.
+
+	Fields of a record:
+		generation	number of the generation the record is about
+		population	alive cells
+		births		cells that came alive
+		deaths		alive cells that died or started dying
+		changes		cells that were born or died (births + deaths)
+		left top right bottom	inclusive box around the alive cells, right < left when there are none
+
+	Files ending in .bin are binary, anything else is CSV with a header line and one line per generation, an empty
+	board has empty box columns. Binary files are little endian:
+		StatsHeader, 16 bytes
+		one StatsRecord of 9 int64 per generation
+*/
+
+const char STATS_MAGIC[8] = { 'G', 'O', 'L', 'S', 'T', 'A', 'T', '\0' };
+const uint32_t STATS_VERSION = 1;
+
+struct StatsHeader
+{
+	char magic[8];			//STATS_MAGIC
+	uint32_t version;		//STATS_VERSION
+	uint32_t fields;		//int64 fields per record
+};
+
+struct StatsRecord
+{
+	int64_t generation;
+	int64_t population;
+	int64_t births;
+	int64_t deaths;
+	int64_t changes;
+	int64_t left;
+	int64_t top;
+	int64_t right;
+	int64_t bottom;
+};
+
+static_assert(sizeof(StatsHeader) == 16, "stats header must keep its size");
+static_assert(sizeof(StatsRecord) == 9 * sizeof(int64_t), "stats records must not be padded");
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class StatsStream
+{
+public:
+	static const size_t BUFFER_SIZE = 1 << 20;
+
+	StatsStream() : m_file(nullptr), m_binary(false), m_records(0) {}
+	~StatsStream() { close(); }
+
+	StatsStream(const StatsStream &) = delete;
+	StatsStream &operator=(const StatsStream &) = delete;
+
+	//creates or truncates the file, returns false with a message in error when it can't
+	bool open(const std::string &path, std::string &error);
+
+	//flushes and closes the file, returns false when anything could not be written
+	bool close();
+
+	bool isOpen() const { return m_file != nullptr; }
+	long long records() const { return m_records; }
+
+	//writes the record of generation, aliveBefore is the alive count of the generation before it
+	void write(long long generation, const StepStats &stats, long long aliveBefore);
+
+private:
+	FILE *m_file;
+	bool m_binary;
+	long long m_records;
+	std::vector<char> m_buffer;	//stdio buffer, lives as long as the file is open
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool StatsStream::open(const std::string &path, std::string &error)
+{
+	close();
+	m_binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+#ifdef _MSC_VER
+	fopen_s(&m_file, path.c_str(), m_binary ? "wb" : "w");
+#else
+	m_file = fopen(path.c_str(), m_binary ? "wb" : "w");
+#endif
+	if (!m_file)
+	{
+		error = "can't create " + path;
+		return false;
+	}
+	m_buffer.resize(BUFFER_SIZE);
+	setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+	m_records = 0;
+
+	if (m_binary)
+	{
+		StatsHeader header = {};
+		memcpy(header.magic, STATS_MAGIC, sizeof(header.magic));
+		header.version = STATS_VERSION;
+		header.fields = sizeof(StatsRecord) / sizeof(int64_t);
+		fwrite(&header, sizeof(header), 1, m_file);
+	}
+	else
+	{
+		fputs("generation,population,births,deaths,changes,left,top,right,bottom\n", m_file);
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool StatsStream::close()
+{
+	if (!m_file)
+	{
+		return true;
+	}
+	bool ok = fflush(m_file) == 0 && !ferror(m_file);
+	ok = fclose(m_file) == 0 && ok;
+	m_file = nullptr;
+	m_buffer = std::vector<char>();
+	return ok;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void StatsStream::write(long long generation, const StepStats &stats, long long aliveBefore)
+{
+	StatsRecord record;
+	record.generation = generation;
+	record.population = stats.aliveCount;
+	record.births = stats.births();
+	record.deaths = stats.deaths(aliveBefore);
+	record.changes = record.births + record.deaths;
+	record.left = stats.bounds.left;
+	record.top = stats.bounds.top;
+	record.right = stats.bounds.right;
+	record.bottom = stats.bounds.bottom;
+	m_records++;
+
+	if (m_binary)
+	{
+		fwrite(&record, sizeof(record), 1, m_file);
+	}
+	else if (stats.bounds.empty())
+	{
+		fprintf(m_file, "%lld,%lld,%lld,%lld,%lld,,,,\n", (long long)record.generation, (long long)record.population,
+				(long long)record.births, (long long)record.deaths, (long long)record.changes);
+	}
+	else
+	{
+		fprintf(m_file, "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld\n", (long long)record.generation, (long long)record.population,
+				(long long)record.births, (long long)record.deaths, (long long)record.changes,
+				(long long)record.left, (long long)record.top, (long long)record.right, (long long)record.bottom);
+	}
+}
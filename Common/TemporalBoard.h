@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LifeEngine.h"
+#include "BitBoard.h"
+#include "CpuFeatures.h"
+
+/**
+	Packed board that computes several generations per pass over memory (temporal blocking).
+
+	The board is cut into bands of whole rows. A band is read with `depth` extra rows above and below it and stepped
+	`depth` times in two scratch buffers that stay in the L2 cache, every generation one row less of the halo is right
+	(a cell only sees one cell further per generation), so after the last one exactly the band is right and goes to the
+	other board. Halo rows are computed by both bands next to each other, that is the price for reading and writing the
+	board once per `depth` generations instead of every generation. At the board edges there is nothing to lose, the
+	cells beyond are dead.
+
+	Depth and band height are picked from the L2 size and the row length on load: the two scratch buffers of a band
+	and its halo fill half of L2, and the halo rows are about a sixth of them so little work is repeated. Neither is
+	more than the board height.
+
+	step() hands out the generations of a pass one after the other, the stats of each generation are counted from the
+	band rows only while they are computed. The board of a generation inside a pass isn't kept, store() recomputes it
+	from the board the pass started from, each next store() only steps on from the last one. Rule changes finish the
+	pass at the current generation. This engine is for long headless runs of large boards, drawing every generation
+	costs one more step per generation.
+*/
+
+class TemporalEngine : public LifeEngine
+{
+public:
+	static const int MAX_DEPTH = 16;
+
+	TemporalEngine() : m_depth(1), m_bandRows(1), m_delivered(0), m_replayed(-1) {}
+
+	const char *name() const override { return "temporal"; }
+	std::string stepReport() const override;
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setRule(const Rule &rule) override;
+
+	//generations per pass and rows per band picked for the loaded board
+	int depth() const { return m_depth; }
+	int bandRows() const { return m_bandRows; }
+
+private:
+	//picks depth and band height for a board of height rows of words words
+	void chooseBlocking(int words, int height);
+
+	//rows per band of a pass, a few bands per thread to steal from as long as bands stay well above their halo
+	int passBandRows() const;
+
+	//steps rows first..last-1 of m_current depth times into m_next, stats holds one entry per generation
+	template<class RuleType>
+	void stepBand(const RuleType &rule, int first, int last, uint64_t *scratch, StepStats *stats);
+
+	//makes m_current the board of the generation handed out last and drops the rest of the pass
+	void finishPass();
+
+	//board of the generation handed out last, recomputed from the start of the pass when it is inside one
+	const BitBoard &deliveredBoard() const;
+
+	BitBoard m_current;					//start of the pass, end of it after the pass
+	BitBoard m_next;
+	int m_depth;
+	int m_bandRows;
+	std::vector<std::vector<uint64_t>> m_scratch;	//two buffers of band and halo rows per thread
+	std::vector<StepStats> m_bandStats;	//depth entries per band
+	std::vector<StepStats> m_passStats;	//stats of the generations of the current pass
+	int m_delivered;					//generations of the pass handed out by step
+	mutable BitBoard m_replay;			//board of a generation inside the pass for store
+	mutable BitBoard m_replayNext;
+	mutable int m_replayed;				//generation of the pass m_replay holds, -1 when none
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::string TemporalEngine::stepReport() const
+{
+	char text[96];
+	snprintf(text, sizeof(text), "%d generations per pass, bands of %d rows, L2 %lld KB", m_depth, passBandRows(), detectL2CacheBytes() / 1024);
+	return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TemporalEngine::chooseBlocking(int words, int height)
+{
+	//two buffers of band and halo rows in half of L2
+	long long rowBytes = (std::max)(1, words) * (long long)sizeof(uint64_t);
+	int rows = (int)(std::max)(8LL, detectL2CacheBytes() / 2 / (2 * rowBytes));
+	m_depth = (std::max)(1, (std::min)(MAX_DEPTH, rows / 12));
+	m_bandRows = rows - 2 * m_depth;
+
+	//a board lower than that is one band, and a halo as deep as the board already reaches its edges
+	m_bandRows = (std::max)(1, (std::min)(m_bandRows, height));
+	m_depth = (std::max)(1, (std::min)(m_depth, height));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int TemporalEngine::passBandRows() const
+{
+	int height = m_current.height();
+	int threads = m_pool ? m_pool->threadCount() : 1;
+	return threads > 1 ? (std::min)(m_bandRows, (std::max)(4 * m_depth, (height + threads * 4 - 1) / (threads * 4))) : m_bandRows;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TemporalEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_current.resize(width, height);
+	m_next.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (cells[y * stride + x] == 1)
+			{
+				m_current.set(x, y, true);
+			}
+		}
+	}
+	chooseBlocking(m_current.wordsPerRow(), height);
+	m_passStats.clear();
+	m_delivered = 0;
+	m_replayed = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TemporalEngine::store(int *cells, int stride) const
+{
+	const BitBoard &board = deliveredBoard();
+	for (int y = 0; y < board.height(); y++)
+	{
+		for (int x = 0; x < board.width(); x++)
+		{
+			cells[y * stride + x] = board.get(x, y);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool TemporalEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	finishPass(); //generations computed ahead used the old rule
+	m_rule = rule;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline const BitBoard &TemporalEngine::deliveredBoard() const
+{
+	if (m_delivered == (int)m_passStats.size()) //pass is over, m_current is its last generation
+	{
+		return m_current;
+	}
+
+	//m_next still holds the start of the pass
+	if (m_replayed < 0 || m_replayed > m_delivered)
+	{
+		m_replay = m_next;
+		m_replayNext.resize(m_next.width(), m_next.height());
+		m_replayed = 0;
+	}
+	for (; m_replayed < m_delivered; m_replayed++)
+	{
+		m_replay.step(m_replayNext, m_rule);
+		m_replay.swap(m_replayNext);
+	}
+	return m_replay;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TemporalEngine::finishPass()
+{
+	if (m_delivered < (int)m_passStats.size())
+	{
+		m_current = deliveredBoard();
+	}
+	m_passStats.clear();
+	m_delivered = 0;
+	m_replayed = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class RuleType>
+inline void TemporalEngine::stepBand(const RuleType &rule, int first, int last, uint64_t *scratch, StepStats *stats)
+{
+	int height = m_current.height();
+	int words = m_current.wordsPerRow();
+	uint64_t lastMask = m_current.lastMask();
+	const uint64_t *zero = m_current.zeroRow();
+
+	//rows top..bottom-1 of the widest generation, both scratch buffers are indexed from top
+	int top = (std::max)(0, first - m_depth);
+	int bottom = (std::min)(height, last + m_depth);
+	size_t bufferWords = (size_t)(bottom - top) * words;
+	uint64_t *buffers[2] = { scratch, scratch + bufferWords };
+
+	for (int generation = 1; generation <= m_depth; generation++)
+	{
+		//the first generation reads the board, the last one writes the band into the other board
+		const uint64_t *in = generation == 1 ? m_current.row(top) : buffers[(generation - 1) & 1];
+		uint64_t *out = generation == m_depth ? nullptr : buffers[generation & 1];
+		int from = (std::max)(0, first - m_depth + generation);
+		int to = (std::min)(height, last + m_depth - generation);
+		StepStats halo;
+		for (int y = from; y < to; y++)
+		{
+			const uint64_t *above = y > 0 ? in + (size_t)(y - 1 - top) * words : zero;
+			const uint64_t *row = in + (size_t)(y - top) * words;
+			const uint64_t *below = y + 1 < height ? in + (size_t)(y + 1 - top) * words : zero;
+			uint64_t *target = out ? out + (size_t)(y - top) * words : m_next.row(y);
+			bool inBand = y >= first && y < last;
+			StepStats &rowStats = inBand ? stats[generation - 1] : halo;
+			long long alive = rowStats.aliveCount;
+			stepBitRow(rule, above, row, below, target, words, lastMask, (uint64_t)y * m_current.width(), rowStats);
+			if (inBand && rowStats.aliveCount != alive)
+			{
+				addBitRowBounds(target, words, 0, y, rowStats.bounds);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats TemporalEngine::step()
+{
+	if (m_delivered < (int)m_passStats.size())
+	{
+		return m_passStats[m_delivered++];
+	}
+
+	if (m_current.wordsPerRow() == 0) //empty board
+	{
+		return StepStats();
+	}
+
+	int height = m_current.height();
+	int threads = m_pool ? m_pool->threadCount() : 1;
+	int bandRows = passBandRows();
+	int bands = (std::max)(1, (height + bandRows - 1) / bandRows);
+	size_t scratchWords = 2 * (size_t)(std::min)(height, bandRows + 2 * m_depth) * m_current.wordsPerRow();
+	m_scratch.resize(threads);
+	for (std::vector<uint64_t> &scratch : m_scratch)
+	{
+		scratch.resize(scratchWords);
+	}
+	m_bandStats.assign((size_t)bands * m_depth, StepStats());
+
+	auto runBand = [&](int band, int thread)
+	{
+		int first = band * bandRows;
+		int last = (std::min)(height, first + bandRows);
+		withRule(m_rule, [&](const auto &rule)
+		{
+			stepBand(rule, first, last, m_scratch[thread].data(), &m_bandStats[(size_t)band * m_depth]);
+		});
+	};
+	if (m_pool && bands > 1)
+	{
+		m_pool->parallelFor(bands, runBand);
+	}
+	else
+	{
+		for (int band = 0; band < bands; band++)
+		{
+			runBand(band, 0);
+		}
+	}
+
+	//generations of the pass from the bands in band order
+	m_passStats.assign(m_depth, StepStats());
+	for (int band = 0; band < bands; band++)
+	{
+		for (int generation = 0; generation < m_depth; generation++)
+		{
+			const StepStats &bandStats = m_bandStats[(size_t)band * m_depth + generation];
+			StepStats &stats = m_passStats[generation];
+			stats.aliveCount += bandStats.aliveCount;
+			stats.survivors += bandStats.survivors;
+			stats.hashDelta ^= bandStats.hashDelta;
+			stats.bounds.add(bandStats.bounds);
+		}
+	}
+
+	//m_next keeps the start of the pass for store
+	m_current.swap(m_next);
+	m_delivered = 0;
+	m_replayed = -1;
+	return m_passStats[m_delivered++];
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+	Persistent worker pool with work stealing.
+
+	parallelFor splits the task indices into one contiguous block per thread. Every thread takes work from the front
+	of its own queue and when that runs dry steals from the back of the other queues, so a thread that got cheap tasks
+	(empty part of the board) helps the ones that got expensive tasks. The calling thread works as thread 0.
+	Threads are created once and sleep between calls. Tasks can be told which thread runs them, so they can keep
+	buffers per thread and reuse them from task to task.
+*/
+
+class ThreadPool
+{
+public:
+	//threads is the total number of threads including the caller, 1 runs everything on the caller
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	int threadCount() const { return (int)m_queues.size(); }
+
+	//runs task(i) for every i in 0..count-1 and returns when all of them are done
+	void parallelFor(int count, const std::function<void(int)> &task);
+
+	//same with task(i, thread), thread is 0..threadCount()-1 and no two tasks run on one thread at the same time
+	void parallelFor(int count, const std::function<void(int, int)> &task);
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<int> items;
+	};
+
+	//takes one task from own queue or steals one, returns false when every queue is empty
+	bool runOne(int self);
+
+	void workerLoop(int self);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;	//one per thread, 0 belongs to the caller
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;					//new batch or stop
+	std::condition_variable m_done;					//last task of a batch finished
+	const std::function<void(int, int)> *m_task;
+	std::atomic<int> m_remaining;					//tasks of the current batch not finished yet
+	unsigned long long m_batch;						//incremented for every parallelFor
+	bool m_stop;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline ThreadPool::ThreadPool(int threads)
+{
+	if (threads < 1)
+	{
+		threads = 1;
+	}
+	m_task = nullptr;
+	m_remaining = 0;
+	m_batch = 0;
+	m_stop = false;
+
+	for (int i = 0; i < threads; i++)
+	{
+		m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (int i = 1; i < threads; i++)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ThreadPool::parallelFor(int count, const std::function<void(int)> &task)
+{
+	parallelFor(count, std::function<void(int, int)>([&task](int i, int) { task(i); }));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ThreadPool::parallelFor(int count, const std::function<void(int, int)> &task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (m_threads.empty()) //single thread, no queues needed
+	{
+		for (int i = 0; i < count; i++)
+		{
+			task(i, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_remaining = count;
+
+		//contiguous block of tasks for every thread
+		int threads = threadCount();
+		for (int t = 0; t < threads; t++)
+		{
+			std::lock_guard<std::mutex> queueLock(m_queues[t]->mutex);
+			for (int i = (int)((long long)count * t / threads); i < (int)((long long)count * (t + 1) / threads); i++)
+			{
+				m_queues[t]->items.push_back(i);
+			}
+		}
+		m_batch++;
+	}
+	m_wake.notify_all();
+
+	//caller works too
+	while (runOne(0))
+	{
+	}
+
+	//wait for tasks still running on workers
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [&] { return m_remaining == 0; });
+	m_task = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool ThreadPool::runOne(int self)
+{
+	int item = -1;
+	int threads = threadCount();
+
+	//own queue from the front
+	{
+		std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+		if (!m_queues[self]->items.empty())
+		{
+			item = m_queues[self]->items.front();
+			m_queues[self]->items.pop_front();
+		}
+	}
+
+	//steal from the back of the others
+	for (int i = 1; i < threads && item < 0; i++)
+	{
+		Queue &victim = *m_queues[(self + i) % threads];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.items.empty())
+		{
+			item = victim.items.back();
+			victim.items.pop_back();
+		}
+	}
+
+	if (item < 0)
+	{
+		return false;
+	}
+
+	(*m_task)(item, self);
+
+	if (--m_remaining == 0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done.notify_all();
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void ThreadPool::workerLoop(int self)
+{
+	unsigned long long seenBatch = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stop || m_batch != seenBatch; });
+			if (m_stop)
+			{
+				return;
+			}
+			seenBatch = m_batch;
+		}
+
+		while (runOne(self))
+		{
+		}
+	}
+}
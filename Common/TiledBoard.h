@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LifeEngine.h"
+#include "BitBoard.h"
+
+/**
+	Packed board split into tiles of 64 x 64 cells (one word wide, 64 rows high) that skips quiescent regions.
+
+	Every tile has a flag telling whether it changed in the previous generation. A tile is only recomputed when it or
+	one of its eight neighbour tiles changed, a cell can't change without a change within one cell of it.
+	A skipped tile didn't change in the previous generation, so both ping-pong boards already hold the same cells
+	for it and nothing has to be copied. Its alive count and bounding box are remembered from the last time it was computed.
+*/
+
+class TiledEngine : public LifeEngine
+{
+public:
+	static const int TILE_ROWS = 64; //a tile is one word (64 cells) wide
+
+	TiledEngine() : m_tilesX(0), m_tilesY(0), m_tileCount(0), m_skippedTiles(0) {}
+
+	const char *name() const override { return "tiled"; }
+	std::string stepReport() const override;
+	void load(const int *cells, int width, int height, int stride) override;
+	void store(int *cells, int stride) const override;
+	StepStats step() override;
+	bool setRule(const Rule &rule) override;
+
+	//fraction of tiles skipped in the last step (0 - 1)
+	double skippedFraction() const { return m_tileCount ? (double)m_skippedTiles / m_tileCount : 0.0; }
+
+private:
+	//steps one row of tiles, returns number of skipped tiles
+	template<class RuleType>
+	int stepTileRow(const RuleType &rule, int tileY, StepStats &stats);
+
+	BitBoard m_current;
+	BitBoard m_next;
+	int m_tilesX;
+	int m_tilesY;
+	int m_tileCount;
+	int m_skippedTiles;							//tiles skipped in the last step
+	std::vector<uint8_t> m_changed;				//tile changed in the previous generation
+	std::vector<uint8_t> m_changedNext;			//tile changed in this generation
+	std::vector<long long> m_tilePopulation;	//alive cells in tile
+	std::vector<CellBounds> m_tileBounds;		//alive cells in tile
+	std::vector<int> m_bandSkipped;				//skipped tiles per tile row
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline std::string TiledEngine::stepReport() const
+{
+	char text[64];
+	snprintf(text, sizeof(text), "skipped tiles: %.1f%%", skippedFraction() * 100.0);
+	return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TiledEngine::load(const int *cells, int width, int height, int stride)
+{
+	m_current.resize(width, height);
+	m_next.resize(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (cells[y * stride + x] == 1)
+			{
+				m_current.set(x, y, true);
+			}
+		}
+	}
+
+	m_tilesX = m_current.wordsPerRow();
+	m_tilesY = (height + TILE_ROWS - 1) / TILE_ROWS;
+	m_tileCount = m_tilesX * m_tilesY;
+	m_skippedTiles = 0;
+
+	//everything is computed in the first generation
+	m_changed.assign(m_tileCount, 1);
+	m_changedNext.assign(m_tileCount, 1);
+	m_tilePopulation.assign(m_tileCount, 0);
+	m_tileBounds.assign(m_tileCount, CellBounds());
+	m_bandSkipped.assign(m_tilesY, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void TiledEngine::store(int *cells, int stride) const
+{
+	for (int y = 0; y < m_current.height(); y++)
+	{
+		for (int x = 0; x < m_current.width(); x++)
+		{
+			cells[y * stride + x] = m_current.get(x, y);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool TiledEngine::setRule(const Rule &rule)
+{
+	if (rule.states != 2) //a bit holds two states
+	{
+		return false;
+	}
+	m_rule = rule;
+	std::fill(m_changed.begin(), m_changed.end(), 1); //quiet tiles may change under the new rule
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class RuleType>
+inline int TiledEngine::stepTileRow(const RuleType &rule, int tileY, StepStats &stats)
+{
+	int skipped = 0;
+	int firstRow = tileY * TILE_ROWS;
+	int lastRow = (firstRow + TILE_ROWS < m_current.height()) ? firstRow + TILE_ROWS : m_current.height();
+
+	for (int tileX = 0; tileX < m_tilesX; tileX++)
+	{
+		int tile = tileY * m_tilesX + tileX;
+
+		//active when this tile or a neighbour changed last generation
+		bool active = false;
+		for (int ty = tileY - 1; ty <= tileY + 1 && !active; ty++)
+		{
+			for (int tx = tileX - 1; tx <= tileX + 1; tx++)
+			{
+				if (tx >= 0 && ty >= 0 && tx < m_tilesX && ty < m_tilesY && m_changed[ty * m_tilesX + tx])
+				{
+					active = true;
+					break;
+				}
+			}
+		}
+
+		if (!active) //unchanged tile: every alive cell survives and the hash stays
+		{
+			m_changedNext[tile] = 0;
+			stats.aliveCount += m_tilePopulation[tile];
+			stats.survivors += m_tilePopulation[tile];
+			stats.bounds.add(m_tileBounds[tile]);
+			skipped++;
+			continue;
+		}
+
+		StepStats tileStats;
+		bool changed = false;
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			const uint64_t *above = (y > 0) ? m_current.row(y - 1) : m_current.zeroRow();
+			const uint64_t *below = (y + 1 < m_current.height()) ? m_current.row(y + 1) : m_current.zeroRow();
+			uint64_t *out = m_next.row(y);
+			stepBitWords(rule, above, m_current.row(y), below, out, tileX, tileX + 1, m_current.wordsPerRow(), m_current.lastMask(), (uint64_t)y * m_current.width(), tileStats);
+			changed |= out[tileX] != m_current.row(y)[tileX];
+			if (out[tileX])
+			{
+				addBitRowBounds(out + tileX, 1, tileX * 64LL, y, tileStats.bounds);
+			}
+		}
+
+		m_changedNext[tile] = changed;
+		m_tilePopulation[tile] = tileStats.aliveCount;
+		m_tileBounds[tile] = tileStats.bounds;
+		stats.bounds.add(tileStats.bounds);
+		stats.aliveCount += tileStats.aliveCount;
+		stats.survivors += tileStats.survivors;
+		stats.hashDelta ^= tileStats.hashDelta;
+	}
+	return skipped;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline StepStats TiledEngine::step()
+{
+	//bands are made of whole tile rows so every tile is stepped by one thread
+	StepStats stats = forEachBand(m_tilesY, [&](int firstTileRow, int lastTileRow, StepStats &bandStats)
+	{
+		withRule(m_rule, [&](const auto &rule)
+		{
+			for (int tileY = firstTileRow; tileY < lastTileRow; tileY++)
+			{
+				m_bandSkipped[tileY] = stepTileRow(rule, tileY, bandStats);
+			}
+		});
+	});
+
+	m_skippedTiles = 0;
+	for (int skipped : m_bandSkipped)
+	{
+		m_skippedTiles += skipped;
+	}
+
+	m_current.swap(m_next);
+	m_changed.swap(m_changedNext);
+	return stats;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+/**
+	Lock-free triple buffer for handing the latest value from one writer thread to one reader thread.
+
+	The writer fills its own slot and publishes it by swapping it with the middle slot. The reader takes the middle
+	slot by swapping it with its own slot, but only when something new was published since. Neither side ever waits,
+	the writer can publish faster than the reader looks and the values in between are simply dropped.
+*/
+
+template<class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : m_middle(1), m_write(0), m_read(2) {}
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	//slot the writer fills, only the writer thread may touch it
+	T &writeSlot() { return m_slots[m_write]; }
+
+	//hands the write slot over to the reader, writer gets an old slot to fill next
+	void publish()
+	{
+		int old = m_middle.exchange(m_write | FRESH, std::memory_order_acq_rel);
+		m_write = old & INDEX;
+	}
+
+	//takes the latest published slot, returns false when nothing new was published
+	bool acquire()
+	{
+		if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+		{
+			return false;
+		}
+		int old = m_middle.exchange(m_read, std::memory_order_acq_rel);
+		m_read = old & INDEX;
+		return true;
+	}
+
+	//slot the reader took last, only the reader thread may touch it
+	const T &readSlot() const { return m_slots[m_read]; }
+
+private:
+	static const int INDEX = 3;		//slot bits of m_middle
+	static const int FRESH = 4;		//middle slot was published and not taken yet
+
+	T m_slots[3];
+	std::atomic<int> m_middle;		//index of the middle slot and FRESH flag
+	int m_write;					//owned by writer
+	int m_read;						//owned by reader
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+	Zobrist hashing of boards and detection of repeating generations.
+
+	Every cell index has a random 64-bit key and the hash of a board is the XOR of the keys of its alive cells.
+	A step only has to XOR in the keys of the cells that were born or died, so engines keep the hash up to date as a
+	by-product of the step (StepStats::hashDelta) at a cost that follows the number of changes, not the board size.
+	Keys are computed from the index with a mixing function instead of being stored, so any board size works.
+	Boards of Generations rules hash every non-dead state, state 1 uses the plain cell key so two state boards hash
+	the same either way.
+
+	CycleDetector remembers the generation of the hashes it has seen. The first time a hash comes back the board is
+	in a cycle: the earlier generation is where the cycle starts and the difference is its period (1 for still lifes).
+	Only a window of the most recent hashes is kept, the oldest one is forgotten when a new one comes in, so memory
+	stays bounded however long a run goes. A cycle is seen at its first repeat, when the generation it starts at is
+	one period back, so start and period are exact for every period up to the window and longer cycles are not
+	found at all. The hashes live in one flat table that reset empties but keeps, so a detector used for run after
+	run (a soup ensemble) stops allocating once its table is big enough.
+*/
+
+//Random looking key of a cell index (splitmix64 finalizer)
+inline uint64_t zobristKey(uint64_t cell)
+{
+	uint64_t z = cell + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+//Key of a cell in state 1..255, state 0 (dead) has no key
+inline uint64_t zobristStateKey(uint64_t cell, int state)
+{
+	return zobristKey(cell + ((uint64_t)(state - 1) << 48));
+}
+
+//Index of the lowest set bit, bits must not be zero
+inline int lowestBit64(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)bits))
+	{
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(bits >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+//Index of the highest set bit, bits must not be zero
+inline int highestBit64(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(bits >> 32)))
+	{
+		return (int)index + 32;
+	}
+	_BitScanReverse(&index, (unsigned long)bits);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(bits);
+#endif
+}
+
+//XOR of the keys of cells firstCell + i for every set bit i
+inline uint64_t zobristBits(uint64_t firstCell, uint64_t bits)
+{
+	uint64_t hash = 0;
+	while (bits)
+	{
+		hash ^= zobristKey(firstCell + lowestBit64(bits));
+		bits &= bits - 1;
+	}
+	return hash;
+}
+
+//Hash of a whole int board, cell index is y * width + x, cells may hold any state
+inline uint64_t zobristHash(const int *cells, int width, int height, int stride)
+{
+	uint64_t hash = 0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int state = cells[(size_t)y * stride + x];
+			if (state != 0)
+			{
+				hash ^= zobristStateKey((uint64_t)y * width + x, state);
+			}
+		}
+	}
+	return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CycleDetector
+{
+public:
+	//window is the number of most recent generations remembered, the longest period that can be found
+	explicit CycleDetector(size_t window = (size_t)1 << 20) : m_window(window < 1 ? 1 : window), m_count(0), m_oldest(0), m_cycleStart(-1), m_period(0) {}
+
+	//forgets every generation, call when the board is edited, the table keeps its memory for the next run
+	void reset()
+	{
+		if (m_count > 0)
+		{
+			std::fill(m_slots.begin(), m_slots.end(), Slot());
+		}
+		m_recent.clear();
+		m_count = 0;
+		m_oldest = 0;
+		m_cycleStart = -1;
+		m_period = 0;
+	}
+
+	//records hash of a generation, returns true once the board has repeated an earlier generation
+	bool add(uint64_t hash, long long generation)
+	{
+		if (found())
+		{
+			return true;
+		}
+		if ((m_count + 1) * 2 > m_slots.size()) //at most half full keeps the probes short
+		{
+			grow();
+		}
+		Slot *slot = find(hash);
+		if (slot->generation >= 0)
+		{
+			m_cycleStart = slot->generation;
+			m_period = generation - m_cycleStart;
+			return true;
+		}
+		slot->hash = hash;
+		slot->generation = generation;
+		m_count++;
+
+		//window is full, the oldest hash makes room (hashes in the window are all different, a repeat ends the run)
+		if (m_recent.size() < m_window)
+		{
+			m_recent.push_back(hash);
+		}
+		else
+		{
+			erase(m_recent[m_oldest]);
+			m_recent[m_oldest] = hash;
+			m_oldest = m_oldest + 1 == m_window ? 0 : m_oldest + 1;
+		}
+		return false;
+	}
+
+	bool found() const { return m_cycleStart >= 0; }
+
+	//first generation that is part of the cycle, -1 before a cycle is found
+	long long cycleStart() const { return m_cycleStart; }
+
+	//generations in one round of the cycle, 0 before a cycle is found
+	long long period() const { return m_period; }
+
+private:
+	struct Slot
+	{
+		uint64_t hash = 0;
+		long long generation = -1;	//-1 marks a free slot, 0 is a valid hash (empty board)
+	};
+
+	//slot holding hash or the free slot where it goes, hashes are random so their low bits pick the slot
+	Slot *find(uint64_t hash)
+	{
+		size_t mask = m_slots.size() - 1;
+		size_t i = (size_t)hash & mask;
+		while (m_slots[i].generation >= 0 && m_slots[i].hash != hash)
+		{
+			i = (i + 1) & mask;
+		}
+		return &m_slots[i];
+	}
+
+	//frees the slot of hash, the slots after it that probed past it shift back so no probe chain is cut
+	void erase(uint64_t hash)
+	{
+		size_t mask = m_slots.size() - 1;
+		size_t hole = find(hash) - m_slots.data();
+		size_t i = hole;
+		while (true)
+		{
+			i = (i + 1) & mask;
+			if (m_slots[i].generation < 0)
+			{
+				break;
+			}
+			size_t home = (size_t)m_slots[i].hash & mask;
+			//slot i stays when its home lies cyclically in (hole, i]
+			bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+			if (!stays)
+			{
+				m_slots[hole] = m_slots[i];
+				hole = i;
+			}
+		}
+		m_slots[hole] = Slot();
+		m_count--;
+	}
+
+	void grow()
+	{
+		std::vector<Slot> old(m_slots.size() < 64 ? 64 : m_slots.size() * 2);
+		old.swap(m_slots);
+		for (const Slot &slot : old)
+		{
+			if (slot.generation >= 0)
+			{
+				*find(slot.hash) = slot;
+			}
+		}
+	}
+
+	std::vector<Slot> m_slots;		//open addressing table of hash -> generation it was first seen, size is a power of 2
+	std::vector<uint64_t> m_recent;	//hashes of the window in the order they came, a ring once the window is full
+	size_t m_window;				//most hashes remembered
+	size_t m_count;					//used slots
+	size_t m_oldest;				//index in m_recent of the oldest hash once the window is full
+	long long m_cycleStart;
+	long long m_period;
+};
@@ -7,6 +7,15 @@
 #include <chrono>
 #include <thread>
 #include <vector>
+#include <memory>
+#include <random>
+#include "../Common/Engines.h"
+#include "../Common/HashLife.h"
+#include "../Common/ConsoleRenderer.h"
+#include "../Common/RenderThread.h"
+#include "../Common/PatternLoader.h"
+#include "../Common/PhaseTimer.h"
+#include "../Common/RandomFill.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -17,6 +26,9 @@ bool isNumber(const std::string &s);
 
 //faster string to int conversion
 int fast_stoi(const char *p);
+
+//Checks that given string is a generation count (digits only, no 1000 limit)
+bool isGenerationCount(const std::string &s);
 //bool isValid(const std::string &x, const std::string &y);
 
 //for console cursor position setting (faster update but not so nice looking)
@@ -72,36 +84,88 @@ class GameOfLife
 public:
 
 	GameOfLife(int boardWidth, int boardHeight, std::string initialMode); // each game is created with width and height
-	~GameOfLife();
 
 	//updates the board with next generation
 	void onUpdate();
 
-	//draws (outputs) the board into console (# alive . dead)
-	void draw(int newStates[]);		
+	//selects the engine used by onUpdate, with verify the reference loop is run alongside and results compared
+	void setEngine(EngineType type, bool verify);
+
+	//number of threads engines step with, 1 is single threaded (reference engine is always single threaded)
+	void setThreads(int threads);
+
+	//what lies beyond the board edge, engines that can't handle the mode are replaced by the reference engine
+	void setBoundary(Boundary boundary);
+
+	//birth and survival rule, B3/S23 by default, engines that can't run the rule are replaced by the reference engine
+	void setRule(const Rule &rule);
+
+	//draws (outputs) the board into console (# alive . dead), only cells that changed since the last frame are written
+	void draw();		
+
+	//draws the whole board, needed when something else was printed after the last frame
+	void redraw();
+
+	//runs generations with delayMs between them, the board is drawn on its own thread DISPLAY_FPS times a second
+	void runAuto(int delayMs);
+
+	static const int DISPLAY_FPS = 30;
 
 	//builds the board with user placed cells or patterns
 	void build();	
 
 	//returns the size of board
-	int getSize() { return m_size; };
+	long long getSize() { return m_size; };
 
-	//outputs popular prebuild game of life patterns where user can choose what to place
-	std::vector<int> showPatterns();
+	//outputs popular prebuild game of life patterns, user chooses one of them or an .rle/.cells file and its location
+	void showPatterns(std::string &pattern, int &x, int &y);
 
 	//Places individual cells
 	void placeCells();
 
-	//Places predetermined patterns
+	//Places predetermined patterns and pattern files
 	void placePatterns();	
 
+	//Places a pattern given as number of a prebuild pattern or path of a pattern file, returns false if it can't be loaded
+	bool placePattern(const std::string &pattern, int x, int y);
+
+	//jumps the plane of an infinite edge board forward by number of generations with HashLife, other edges can't
+	//be jumped, HashLife has no board edge
+	void fastForward(unsigned long long generations);
+
 private:
-	int *m_output;
-	int *m_state;
-	int m_size;
+	//runs the reference loop on m_grid and compares it to the engines board
+	void verifyEngine(const StepStats &engineStats);
+
+	//copies the engines board into m_grid if it is out of date
+	void syncState();
+
+	//header lines drawn above the board
+	std::vector<std::string> frameHeader() const;
+
+	//copies the current board into the render threads snapshot and publishes it
+	void publishFrame();
+
+	//sets a run of cells starting from x y, # is alive and anything else dead, cells outside of the board are skipped
+	void setCells(int x, int y, const std::string &s);
+
+	//sets length cells starting from x y to alive or dead, cells outside of the board are skipped
+	void placeRun(long long x, long long y, long long length, bool alive);
+
+	HaloGrid<int> m_grid;	//current and next generation with a ghost border
+	Rule m_rule;			//birth and survival rule
+	long long m_size;
 	int m_width;
 	int m_height;
-	int m_generation;	
+	long long m_generation;	
+
+	EngineType m_engineType;			//engine used by onUpdate
+	std::unique_ptr<LifeEngine> m_engine;	//engine object, holds the board while it runs
+	bool m_verifyEngine;				//compare engine against reference every generation
+	bool m_stateDirty;					//engine is ahead of m_grid
+	std::unique_ptr<ThreadPool> m_pool;	//persistent workers for engines, nullptr when single threaded
+	ConsoleRenderer m_renderer;			//keeps the frame on screen for drawing only changes
+	RenderThread *m_renderThread;		//draws snapshots while runAuto is running, nullptr otherwise
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -111,129 +175,317 @@ GameOfLife::GameOfLife(int boardWidth, int boardHeight, std::string initialMode)
 {
 	m_width = boardWidth;
 	m_height = boardHeight;
-	m_size = boardWidth * boardHeight;
-	m_output = new int[m_width * m_height];
-	m_state = new int[m_width * m_height];
-	memset(m_output, 0, m_width * m_height * sizeof(int));
-	memset(m_state, 0, m_width * m_height * sizeof(int));
-
-	//initialization of m_state
-	if (initialMode == "random") //random fill with alive and dead cells
-	{	
-		for (int i = 0; i < m_size; i++)
+	m_size = (long long)boardWidth * boardHeight;
+	m_generation = 0;
+	m_engineType = EngineType::Reference;
+	m_verifyEngine = false;
+	m_stateDirty = false;
+	m_renderThread = nullptr;
+	m_grid.resize(m_width, m_height); //all cells dead
+
+	//initialization of m_grid
+	if (initialMode == "random") //random fill with alive and dead cells, a new board every game
+	{
+		randomBitBoard(std::random_device()(), 50, m_width, m_height, nullptr, [this](int y, const uint64_t *words)
 		{
-			m_state[i] = rand() % 2;
-		}
+			for (int x = 0; x < m_width; x++)
+			{
+				m_grid.at(x, y) = (words[x >> 6] >> (x & 63)) & 1;
+			}
+		});
 	}
-	else //fill with dead cells
+	m_engine = createEngine(m_engineType);
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	redraw();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Draws the cells that changed since the last frame
+void GameOfLife::draw()
+{
+	syncState();
+	m_renderer.render(m_grid.row(0), m_width, m_height, m_grid.stride(), frameHeader());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> GameOfLife::frameHeader() const
+{
+	std::vector<std::string> header;
+	header.push_back("Current generation :  " + std::to_string(m_generation) + "   rule " + ruleString(m_rule) + " ");
+	header.push_back("");
+	if (!m_engine->stepReport().empty())
 	{
-		for (int i = 0; i < m_size; i++)
+		header.push_back(m_engine->stepReport());
+		header.push_back("");
+	}
+	return header;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::publishFrame()
+{
+	Snapshot &frame = m_renderThread->frame();
+	frame.width = m_width;
+	frame.height = m_height;
+	frame.cells.resize((size_t)m_width * m_height);
+	if (m_stateDirty) //straight from the engine, m_grid stays out of date
+	{
+		m_engine->store(frame.cells.data(), m_width);
+	}
+	else
+	{
+		for (int y = 0; y < m_height; y++)
 		{
-			m_state[i] = 0;
+			std::copy(m_grid.row(y), m_grid.row(y) + m_width, frame.cells.begin() + (size_t)y * m_width);
 		}
 	}
-	draw(m_state);
+	frame.header = frameHeader();
+	m_renderThread->publish();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-GameOfLife::~GameOfLife()
+void GameOfLife::redraw()
 {
-	delete[] m_output;
-	delete[] m_state;
+	m_renderer.invalidate();
+	draw();
 }
 
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//Draws the current states of cells.
-void GameOfLife::draw(int newStates[])
+//Update loop of the game
+void GameOfLife::onUpdate()
 {
-	clearScreen();
-	std::cout << "Current generation :  " << m_generation << " \n" << std::endl;
-	std::string sOut;
-
-	//visualize output as a grid 
-	int row = 0;
-	for (int i = 0; i < m_size; i++)
 	{
-		row++;
-		if (row == m_width && i != m_size) //When at end of a row add line change
+		PhaseScope phase(Phase::Step);
+		StepStats stats = m_engine->step();
+		if (m_verifyEngine)
+		{
+			verifyEngine(stats);
+		}
+		else
+		{
+			m_stateDirty = true; //m_grid is refreshed only when it is needed
+		}
+	}
+	
+	m_generation++; // generation counter
+	if (m_renderThread)
+	{
+		if (m_renderThread->wantsFrame()) //generations in between are never shown
 		{
-			sOut = (m_state[i] == 1) ? "#" : ".";
-			std::cout << sOut << std::endl;
-			row = 0;
+			PhaseScope phase(Phase::Snapshot);
+			publishFrame();
 		}
-		else //No line change
+	}
+	else
+	{
+		PhaseScope phase(Phase::Render);
+		draw(); //only births and deaths are written
+	}
+
+	pollPhaseReport(std::cerr); //report signal, printed between generations
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::runAuto(int delayMs)
+{
+	RenderThread renderThread(DISPLAY_FPS);
+	m_renderThread = &renderThread;
+	publishFrame();
+	renderThread.start();
+
+	while (!stopRequested()) //run game loop until the window is closed or Ctrl+C, drawing happens on the render thread
+	{
+		onUpdate();
+		if (delayMs > 0)
 		{
-			sOut = (m_state[i] == 1) ? "#" : ".";
-			std::cout << sOut;
+			PhaseScope phase(Phase::Sleep);
+			std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
 		}
-	}	
+	}
+
+	renderThread.stop();
+	m_renderThread = nullptr;
+	m_renderer.invalidate(); //screen was drawn by the other renderer
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::setEngine(EngineType type, bool verify)
+{
+	syncState(); //take the board from the previous engine
+
+	m_engineType = type;
+	if (m_grid.boundary() == Boundary::Infinite && type != EngineType::Infinite) //only one engine has a plane beyond the board
+	{
+		std::cout << "Infinite edges run on the infinite engine" << std::endl;
+		m_engineType = EngineType::Infinite;
+	}
+	m_engine = createEngine(m_engineType);
+	if (m_engineType != EngineType::Reference && !m_engine->setBoundary(m_grid.boundary()))
+	{
+		std::cout << "Engine '" << m_engine->name() << "' can't do " << boundaryName(m_grid.boundary()) << " edges, using reference engine" << std::endl;
+		m_engineType = EngineType::Reference;
+		m_engine = createEngine(m_engineType);
+	}
+	else if (m_engineType != EngineType::Reference && !m_engine->setRule(m_rule))
+	{
+		std::cout << "Engine '" << m_engine->name() << "' can't run rule " << ruleString(m_rule) << ", using reference engine" << std::endl;
+		m_engineType = EngineType::Reference;
+		m_engine = createEngine(m_engineType);
+	}
+	if (m_engineType == EngineType::Reference) //runs every rule and every edge but infinite
+	{
+		if (m_grid.boundary() == Boundary::Infinite)
+		{
+			std::cout << "Reference engine stops at the board edge, using dead edges" << std::endl;
+			m_grid.setBoundary(Boundary::Dead);
+		}
+		m_engine->setBoundary(m_grid.boundary());
+		m_engine->setRule(m_rule);
+	}
+	m_verifyEngine = verify && m_engineType != EngineType::Reference && m_grid.boundary() != Boundary::Infinite; //reference loop can't follow cells off the board
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	m_engine->setThreadPool(m_pool.get());
+	std::cout << "Engine: " << m_engine->describe() << std::endl;
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//Update loop of the game
-void GameOfLife::onUpdate()
+void GameOfLife::setThreads(int threads)
 {
-	//output current generation
-	std::cout << "Current Generation: " << m_generation << "\n" << std::endl;
+	m_engine->setThreadPool(nullptr); //engine must not use the old pool while it is destroyed
 
-	//lambda function to return the value in output array on x y coordinates (1 or 0)
-	auto cell = [&](int x, int y)
+	m_pool.reset();
+	if (threads > 1)
 	{
-		return m_output[y * m_width + x];
-	};
+		m_pool.reset(new ThreadPool(threads));
+	}
+
+	m_engine->setThreadPool(m_pool.get());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	//store current state to output state output state
-	for (int i = 0; i < m_size; i++)
+void GameOfLife::setBoundary(Boundary boundary)
+{
+	syncState();
+	m_grid.setBoundary(boundary);
+	if (m_engineType != EngineType::Reference || boundary == Boundary::Infinite) //engine is checked for the new mode
+	{
+		setEngine(m_engineType, m_verifyEngine);
+	}
+	else //reference engine does every finite mode
 	{
-		m_output[i] = m_state[i];
+		m_engine->setBoundary(boundary);
 	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	//nested for loop to go through all cells
-	for (int x = 0; x < m_width - 0; x++)
+void GameOfLife::setRule(const Rule &rule)
+{
+	syncState();
+	m_rule = rule;
+	for (int y = 0; y < m_height; y++) //states the new rule doesn't have are dead
 	{
-		for (int y = 0; y < m_height - 0; y++)
+		for (int x = 0; x < m_width; x++)
 		{
-			/*						Neighbours of one cell
-			
-								x-1 y-1		X-0 y-1			X+1 y-1
-								X-1 y-0	   this cell		X+1 y+0
-								X-1	y+1		X+0 y+1			X+1 y+1
-			*/
-			int nNeighbours = cell(x - 1, y - 1) + cell(x - 0, y - 1) + cell(x + 1, y - 1) +
-							  cell(x - 1, y + 0) +			0		  +	cell(x + 1, y + 0) +
-							  cell(x - 1, y + 1) + cell(x + 0, y + 1) + cell(x + 1, y + 1);
+			if (m_grid.at(x, y) >= m_rule.states)
+				m_grid.at(x, y) = 0;
+		}
+	}
+	if (m_engineType != EngineType::Reference) //engine is checked for the new rule
+	{
+		setEngine(m_engineType, m_verifyEngine);
+	}
+	else //reference engine runs every rule
+	{
+		m_engine->setRule(m_rule);
+		m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	}
+}
 
-			if (cell(x, y) == 1)//when alive...
-			{
-				m_state[y * m_width + x] = nNeighbours == 2 || nNeighbours == 3; //and if 2 or 3 neighbours, stay alive else die
-			}
-			else//not alive
-			{
-				m_state[y*m_width + x] = nNeighbours == 3; //come alive when 3 neighbours
-			}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-			//Fast but not so nice looking... if you want to try uncomment this and comment draw at the end of scope		
+//m_grid holds the previous generation when this is called
+void GameOfLife::verifyEngine(const StepStats &engineStats)
+{
+	StepStats referenceStats = stepReferenceGrid(m_grid, m_rule);
 
-			if (cell(x, y) == 1)
+	//previous generation buffer is free after the reference step, use it for the engines board
+	int *engineCells = m_grid.nextRow(0);
+	m_engine->store(engineCells, m_grid.stride());
+	int mismatches = 0;
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			if (engineCells[y * m_grid.stride() + x] != m_grid.at(x, y))
 			{
-				setCursorPosition(x, y);
-				std::cout << "#";
+				mismatches++;
 			}
-			else
-			{
-				setCursorPosition(x, y);
-				std::cout << ".";
-			}			
 		}
 	}
 
-	
-	m_generation++; // generation counter
-	//draw(m_output); // draw states 
+	if (mismatches > 0 || referenceStats.aliveCount != engineStats.aliveCount || referenceStats.survivors != engineStats.survivors ||
+		referenceStats.bounds != engineStats.bounds)
+	{
+		std::cout << "Engine '" << m_engine->name() << "' differs from reference at generation " << m_generation + 1 << ": " << mismatches << " cells, alive "
+				  << engineStats.aliveCount << " vs " << referenceStats.aliveCount << std::endl;
+		m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //continue from the reference board
+	}
+	m_stateDirty = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::syncState()
+{
+	if (m_stateDirty)
+	{
+		m_engine->store(m_grid.row(0), m_grid.stride());
+	}
+	m_stateDirty = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::setCells(int x, int y, const std::string &s)
+{
+	if (y < 0 || y >= m_height)
+	{
+		return;
+	}
+	for (int p = 0; p < (int)s.size(); p++)
+	{
+		if (x + p >= 0 && x + p < m_width)
+		{
+			m_grid.at(x + p, y) = s[p] == L'#' ? 1 : 0;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::placeRun(long long x, long long y, long long length, bool alive)
+{
+	if (y < 0 || y >= m_height)
+	{
+		return;
+	}
+	long long from = x < 0 ? 0 : x;
+	long long to = x + length > m_width ? m_width : x + length;
+	for (long long p = from; p < to; p++)
+	{
+		m_grid.at((int)p, (int)y) = alive ? 1 : 0;
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -260,6 +512,8 @@ void GameOfLife::build()
 
 	std::cout << "got mode answer" << std::endl;
 
+	syncState(); //cells and patterns are placed on top of the current board
+
 	if (sBuildMode == "cells")
 	{
 		placeCells();
@@ -273,6 +527,8 @@ void GameOfLife::build()
 		placePatterns();
 		placeCells();
 	}
+
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //engine continues from the edited board
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -282,17 +538,6 @@ void GameOfLife::placePatterns()
 	bool patternCountAnswer = false;
 	std::string sPatternCount;
 
-	//lambda function to set state of a cell
-	auto set = [&](int x, int y, std::string s)
-	{
-		int p = 0;
-		for (auto cell : s)
-		{
-			m_state[y * m_width + x + p] = cell == L'#' ? 1 : 0;
-			p++;
-		}
-	};
-
 	//int maxPatterns = (m_size > 1000) ? 1000 : m_size;
 	int maxPatterns = 100;
 	std::cout << "Please enter number or patterns you wish to place (MAX = " << maxPatterns << ") : " << std::endl;
@@ -311,110 +556,76 @@ void GameOfLife::placePatterns()
 
 	for (int i = 0; i < stoi(sPatternCount); i++)
 	{
-		std::vector<int> placePattern = showPatterns();
-
-		std::cout << "placePattern : " << placePattern.at(0) << " " << placePattern.at(1) << " " << placePattern.at(2);
-
-		int x = placePattern.at(1);
-		int y = placePattern.at(2);
-
-		switch (placePattern.at(0))
-		{
-		case 1:
-			set(x, y, "##");
-			set(x, y + 1, "##");
-			break;
-		case 2:
-			set(x, y, " ## ");
-			set(x, y + 1, "#  #");
-			set(x, y + 2, " ## ");
-			break;
-		case 3:
-			set(x, y, " ## ");
-			set(x, y + 1, "#  #");
-			set(x, y + 2, " # #");
-			set(x, y + 3, "  # ");
-			break;
-		case 4:
-			set(x, y, "##");
-			set(x, y + 1, "# #");
-			set(x, y + 2, " #");
-			break;
-		case 5:
-			set(x, y, " #");
-			set(x, y + 1, "# #");
-			set(x, y + 2, " #");
-			break;
-		case 6:
-			set(x, y, " # ");
-			set(x, y + 1, " # ");
-			set(x, y + 2, " # ");
-			break;
-		case 7:
-			set(x, y, "    ");
-			set(x, y + 1, " ###");
-			set(x, y + 2, "### ");
-			set(x, y + 3, "    ");
-			break;
-		case 8:
-			set(x, y, "##  ");
-			set(x, y + 1, "##  ");
-			set(x, y + 2, "  ##");
-			set(x, y + 3, "  ##");
-			break;
-		case 9:
-			set(x, y, "  #  ");
-			set(x, y + 1, "  #  ");
-			set(x, y + 2, " # # ");
-			set(x, y + 3, "  #  ");
-			set(x, y + 4, "  #  ");
-			set(x, y + 5, "  #  ");
-			set(x, y + 6, "  #  ");
-			set(x, y + 7, " # # ");
-			set(x, y + 8, "  #  ");
-			set(x, y + 9, "  #  ");
-			break;
-		case 10:
-			set(x, y + 1, " ##");
-			set(x, y + 2, "##");
-			set(x, y + 3, " #");
-			break;
-		case 11:
-			set(x, y + 1, "      # ");
-			set(x, y + 2, "##      ");
-			set(x, y + 3, " #   ###");
-			break;
-		case 12:
-			set(x, y + 1, " #     ");
-			set(x, y + 2, "   #   ");
-			set(x, y + 3, "##  ###");
-			break;
-		case 13:
-			set(x, y + 1, " # ");
-			set(x, y + 2, "  #");
-			set(x, y + 3, "###");
-			break;
-		case 14:
-			set(x, y, "#  # ");
-			set(x, y + 1, "    #");
-			set(x, y + 2, "#   #");
-			set(x, y + 3, " ####");
-			break;
-		case 15:
-			set(x, y, "  #   ");
-			set(x, y + 1, "#   # ");
-			set(x, y + 2, "     #");
-			set(x, y + 3, "#    #");
-			set(x, y + 4, " #####");
-			break;
-		}
-		clearScreen();
-		draw(m_state);
+		std::string pattern;
+		int x = 0;
+		int y = 0;
+		showPatterns(pattern, x, y);
+
+		std::cout << "placePattern : " << pattern << " " << x << " " << y;
+
+		placePattern(pattern, x, y);
+		redraw();
 	}
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool GameOfLife::placePattern(const std::string &pattern, int x, int y)
+{
+	//prebuild patterns in RLE, same order as in showPatterns
+	static const char *prebuild[] =
+	{
+		"2o$2o!",									//block
+		"b2o$o2bo$b2o!",							//beehive
+		"b2o$o2bo$bobo$2bo!",						//loaf
+		"2o$obo$bo!",								//boat
+		"bo$obo$bo!",								//tub
+		"bo$bo$bo!",								//blinker
+		"4b$b3o$3ob$4b!",							//toad
+		"2o2b$2o2b$2b2o$2b2o!",						//beacon
+		"2bo2b$2bo2b$bobob$2bo2b$2bo2b$2bo2b$2bo2b$bobob$2bo2b$2bo2b!",	//penta-decathlon
+		"$b2o$2o$bo!",								//R-pentomino
+		"$6bob$2o6b$bo3b3o!",						//diehard
+		"$bo5b$3bo3b$2o2b3o!",						//acorn
+		"$bob$2bo$3o!",								//glider
+		"o2bob$4bo$o3bo$b4o!",						//LW-ship
+		"2bo3b$o3bob$5bo$o4bo$b5o!"					//MW-ship
+	};
+	const int prebuildCount = sizeof(prebuild) / sizeof(prebuild[0]);
+
+	auto run = [this](long long runX, long long runY, long long length, bool alive)
+	{
+		placeRun(runX, runY, length, alive);
+	};
+
+	PatternInfo info;
+	std::string error;
+	bool loaded;
+	if (isNumber(pattern) && stoi(pattern) >= 1 && stoi(pattern) <= prebuildCount)
+	{
+		PatternSource source(prebuild[stoi(pattern) - 1]);
+		loaded = loadPattern(source, PatternFormat::Rle, x, y, run, info, error);
+	}
+	else
+	{
+		loaded = loadPatternFile(pattern, x, y, run, info, error);
+	}
+
+	if (!loaded)
+	{
+		std::cout << "Could not place pattern: " << error << std::endl;
+		return false;
+	}
+	Rule patternRule;
+	if (!info.rule.empty() && (!parseRule(info.rule, patternRule) || patternRule != m_rule))
+	{
+		std::cout << "Pattern was made for rule " << info.rule << ", it is run with " << ruleString(m_rule) << std::endl;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void GameOfLife::placeCells()
 {
 	std::string sCellNumber; //number of manually placable cells
@@ -427,16 +638,11 @@ void GameOfLife::placeCells()
 	//lambda function to set state of a cell
 	auto set = [&](int x, int y, std::string s)
 	{
-		int p = 0;
-		for (auto cell : s)
-		{
-			m_state[y * m_width + x + p] = cell == L'#' ? 1 : 0;
-			p++;
-		}
+		setCells(x, y, s);
 	};
 
 	//set maximum placable cells to 1000 even if there were more possible cells
-	int maxSize = (m_size > 1000) ? 1000 : m_size;
+	int maxSize = (m_size > 1000) ? 1000 : (int)m_size;
 
 	//Real logic
 	std::cout << "How many cells would you like to place? (MAX =" << m_size << " ): ";
@@ -473,13 +679,50 @@ void GameOfLife::placeCells()
 				cellCounter--;
 			}
 		}
-		draw(m_state);		
+		redraw();		
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::fastForward(unsigned long long generations)
+{
+	syncState();
+	if (m_rule.states > 2)
+	{
+		std::cout << "HashLife only knows two states, can't fast forward rule " << ruleString(m_rule) << std::endl;
+		return;
+	}
+	if (m_grid.boundary() != Boundary::Infinite || m_engineType != EngineType::Infinite)
+	{
+		std::cout << "HashLife runs an unbounded plane, it can only fast forward infinite edges, not a " << boundaryName(m_grid.boundary()) << " board" << std::endl;
+		return;
 	}
+
+	//the whole plane goes through HashLife, cells beyond the board included
+	InfiniteEngine &plane = static_cast<InfiniteEngine &>(*m_engine);
+	HashLife hashLife(1 << 22, m_rule);
+	plane.forEachAlive([&](int64_t x, int64_t y) { hashLife.setCell(x, y, true); });
+	hashLife.advanceTo(generations);
+	hashLife.store(m_grid.row(0), m_width, m_height, m_grid.stride());
+	m_generation += generations;
+
+	//engine continues from the new plane, the board is its window
+	plane.load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	hashLife.forEachAlive([&](int64_t x, int64_t y)
+	{
+		if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+		{
+			plane.set(x, y, true);
+		}
+	});
+	redraw();
+	std::cout << "Population after " << generations << " generations: " << hashLife.population() << " (nodes in cache: " << hashLife.nodeCount() << ")" << std::endl;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<int> GameOfLife::showPatterns()
+void GameOfLife::showPatterns(std::string &pattern, int &x, int &y)
 {
 	bool showAnswer = false;
 	bool patternLocationAnswer = false;
@@ -540,17 +783,17 @@ std::vector<int> GameOfLife::showPatterns()
 
 	std::cout << "--------------------------------------------------------- \n" << std::endl;
 
-	std::cout << "Please choose pattern 1-15 : " << std::endl;
+	std::cout << "Please choose pattern 1-15 or give path of an .rle or .cells file : " << std::endl;
 	while (!showAnswer)
 	{
 		std::getline(std::cin, sOkAnswer);
-		if (!isNumber(sOkAnswer) || stoi(sOkAnswer) < 15 && stoi(sOkAnswer) > 0)
+		if ((!isNumber(sOkAnswer) && !sOkAnswer.empty()) || (isNumber(sOkAnswer) && stoi(sOkAnswer) <= 15 && stoi(sOkAnswer) > 0))
 		{
 			showAnswer = true;
 		}
 		else
 		{
-			std::cout << "Please choose pattern 1-15 : " << std::endl;
+			std::cout << "Please choose pattern 1-15 or give path of an .rle or .cells file : " << std::endl;
 		}
 	}
 
@@ -569,14 +812,9 @@ std::vector<int> GameOfLife::showPatterns()
 		}
 	}
 
-	std::vector<int> returnVec;
-	returnVec.push_back(stoi(sOkAnswer));
-	returnVec.push_back(stoi(sLocationAnswerX));
-	returnVec.push_back(stoi(sLocationAnswerY));
-
-	std::cout << "return vec" << returnVec.at(0) << std::endl;
-	return returnVec;
-	
+	pattern = sOkAnswer;
+	x = stoi(sLocationAnswerX);
+	y = stoi(sLocationAnswerY);
 }
 
 //Class side end
@@ -585,6 +823,7 @@ std::vector<int> GameOfLife::showPatterns()
 
 int main()
 {
+	installPhaseSignals(); //report on Ctrl+Break, stop on Ctrl+C
 
 	//Strings for getlines
 	std::string sWidth;
@@ -592,12 +831,28 @@ int main()
 	std::string sInitialMode;
 	std::string sUpdateTime;
 	std::string sStyleChoice;	
+	std::string sEngine;
+	std::string sVerify;
+	std::string sThreads;
+	std::string sBoundary;
+	std::string sFastForward;
+	std::string sRule;
 
 	//Checks for user input while loops
 	bool boardAnswer = false;
 	bool stageAnswer = false;
 	bool modeAnswer = false;
 	bool timerAnswer = false;
+	bool engineAnswer = false;
+	bool threadsAnswer = false;
+	bool boundaryAnswer = false;
+	bool fastForwardAnswer = false;
+	bool ruleAnswer = false;
+
+	EngineType engineType = EngineType::Reference;
+	Boundary boundary = Boundary::Dead;
+	Rule rule;
+	bool verifyEngine = false;
 
 	//START
 	std::cout << "Game of Life \n" << std::endl;
@@ -606,7 +861,7 @@ int main()
 	{		
 		std::getline(std::cin, sWidth);
 		std::getline(std::cin, sHeight);	
-		if (!isNumber(sWidth) || !isNumber(sHeight))
+		if (!isNumber(sWidth) || !isNumber(sHeight) || stoi(sWidth) > 1000 || stoi(sHeight) > 1000)
 		{
 			std::cout << "Give size of the board WIDTH x HEIGHT as numbers 0123456789:  " << std::endl;
 		}
@@ -630,13 +885,105 @@ int main()
 		}
 	}
 
+	//Birth and survival rule, patterns are placed for this rule
+	std::cout << "Give rule as B/S rulestring like B36/S23, Generations rule like B2/S/C3 or one of " << ruleNames() << " (empty for B3/S23)" << std::endl;
+	while (!ruleAnswer) //wait for rule answer
+	{
+		std::getline(std::cin, sRule);
+		if (!sRule.empty() && !parseRule(sRule, rule))
+		{
+			std::cout << "Please give rule like B3/S23 (B0 rules can't be run) or one of " << ruleNames() << std::endl;
+		}
+		else
+		{
+			ruleAnswer = true;
+		}
+	}
+
 	//create game object instance
 	GameOfLife game(stoi(sWidth), stoi(sHeight), sInitialMode);
+	game.setRule(rule);
 	if (sInitialMode == "build") // handle building in class side
 	{
 		game.build();
 	}
 
+	//What is beyond the edges of the board
+	std::cout << "Give board edge 'dead', 'torus' (wraps around), 'mirror' or 'infinite' (board is a window onto an unbounded plane)" << std::endl;
+	while (!boundaryAnswer) //wait for edge answer
+	{
+		std::getline(std::cin, sBoundary);
+		if (!parseBoundary(sBoundary, boundary))
+		{
+			std::cout << "Please give 'dead', 'torus', 'mirror' or 'infinite'" << std::endl;
+		}
+		else
+		{
+			boundaryAnswer = true;
+		}
+	}
+	game.setBoundary(boundary);
+
+	//Select simulation engine
+	std::cout << "Give simulation engine (" << engineList() << ")" << std::endl;
+	while (!engineAnswer) //wait for engine answer
+	{
+		std::getline(std::cin, sEngine);
+		if (!parseEngine(sEngine, engineType))
+		{
+			std::cout << "Please give one of the engines: " << engineList() << std::endl;
+		}
+		else
+		{
+			engineAnswer = true;
+		}
+	}
+	if (engineType != EngineType::Reference)
+	{
+		std::cout << "Compare every generation against reference engine? (Y,N)" << std::endl;
+		std::getline(std::cin, sVerify);
+		verifyEngine = (sVerify == "y" || sVerify == "Y");
+
+		std::cout << "Give number of threads (1 - " << std::thread::hardware_concurrency() << ")" << std::endl;
+		while (!threadsAnswer) //wait for thread count
+		{
+			std::getline(std::cin, sThreads);
+			if (!isNumber(sThreads) || stoi(sThreads) < 1)
+			{
+				std::cout << "Please give number of threads as number 0123456789" << std::endl;
+			}
+			else
+			{
+				threadsAnswer = true;
+			}
+		}
+		game.setThreads(stoi(sThreads));
+	}
+	game.setEngine(engineType, verifyEngine);
+
+	//Jump ahead, useful for methuselahs that take thousands of generations to settle, HashLife has no board edge so only
+	//the infinite plane can be jumped
+	if (boundary == Boundary::Infinite)
+	{
+		std::cout << "Fast forward how many generations with HashLife? (0 = start from this board, the plane beyond the board comes along)" << std::endl;
+		while (!fastForwardAnswer) //wait for generation count
+		{
+			std::getline(std::cin, sFastForward);
+			if (!isGenerationCount(sFastForward))
+			{
+				std::cout << "Please give number of generations as number 0123456789" << std::endl;
+			}
+			else
+			{
+				fastForwardAnswer = true;
+			}
+		}
+		if (std::stoull(sFastForward) > 0)
+		{
+			game.fastForward(std::stoull(sFastForward));
+		}
+	}
+
 	//Select game mode, auto or manual
 	std::cout << "Give you preferred update mode 'auto' or 'manual' (with auto you choose timer lenght, with manual you press space when you want new generations.)" << std::endl;	
 	while (!modeAnswer) //wait for mode answer
@@ -654,7 +1001,7 @@ int main()
 	}
 
 	//User wanted automatic generations
-	std::cout << "Give timer length as ms (keep in mind that larger boards take longet to print so if your board is over 50x50 you might not get fast refresh rate) : ";
+	std::cout << "Give timer length as ms (0 runs at full speed, display refreshes " << GameOfLife::DISPLAY_FPS << " times a second) : ";
 	if (sStyleChoice == "auto")
 	{
 		while (!timerAnswer)//Wait for users correct update time input
@@ -670,26 +1017,26 @@ int main()
 			}
 		}				
 
-		while (true) //run game loop
-		{
-			game.onUpdate();
-			std::this_thread::sleep_for(std::chrono::milliseconds(stoi(sUpdateTime)));
-		}
+		game.runAuto(stoi(sUpdateTime));
 	}
 	else //user wanted manual generations
 	{
 		std::cout << "Press SPACE to generate next generation" << std::endl;
+		game.redraw(); //later generations only write the cells that changed
 
-		while (true)
+		auto inputStart = std::chrono::steady_clock::now(); //waiting for the key is the input phase
+		while (!stopRequested())
 		{		
 			if (GetKeyState(VK_SPACE) & 0x80)
 			{
-				std::cout << "Space was pressed " << std::endl;
+				g_phaseTimer.record(Phase::Input, nanosecondsSince(inputStart));
 				game.onUpdate();
+				inputStart = std::chrono::steady_clock::now();
 			}
 		}		
 	}
 
+	g_phaseTimer.report(std::cout); //where the time went
 	return 0;
 }
 
@@ -697,7 +1044,9 @@ bool isNumber(const std::string &s)
 {
 	if (s.empty())//user just pressed enter
 		return false;
-	
+
+	if (s.length() > 9)//longer could overflow int in stoi, callers check the range they need
+		return false;
 
 	for (int i = 0; i < s.length(); i++)//goes through each char in string, check for numbers
 	{	
@@ -705,7 +1054,18 @@ bool isNumber(const std::string &s)
 		{
 			return false;
 		}
-		else if (stoi(s) > 1000) // 1000 is max numerical im willing to handle this way. feel free to change it but it might brick :D
+	}
+	return true;
+}
+
+bool isGenerationCount(const std::string &s)
+{
+	if (s.empty() || s.length() > 18)//empty or too large for 64 bit
+		return false;
+
+	for (int i = 0; i < s.length(); i++)//goes through each char in string, check for numbers
+	{
+		if (!(s[i] >= '0' && s[i] <= '9'))
 		{
 			return false;
 		}
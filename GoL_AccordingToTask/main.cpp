@@ -10,6 +10,8 @@
 #elif defined __linux__
 #include <iostream>
 #include <sstream>
+#include <cstdlib>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include <vector>
@@ -18,6 +20,20 @@
 #error OS not supported 
 #endif
 
+#include <memory>
+#include <random>
+#include "../Common/Engines.h"
+#include "../Common/ConsoleRenderer.h"
+#include "../Common/RenderThread.h"
+#include "../Common/PatternLoader.h"
+#include "../Common/Checkpoint.h"
+#include "../Common/StatsStream.h"
+#include "../Common/PhaseTimer.h"
+#include "../Common/SoupEnsemble.h"
+#include "../Common/RandomFill.h"
+#include "../Common/FrameExporter.h"
+#include "../Common/CommandLine.h"
+
 /**
 	CONWAY'S GAME OF LIFE 
 		- with modifiable board, placable cells and manual or automatic generations
@@ -33,28 +49,27 @@
 	This project uses console output to visually display generations. This is not fastest or even recommended way of doing things.
 	But that said this is still quite fast depending of the size of board (I suggest no larger than 50x50 for slower PC:s) and speed of your PC.
 	Also it is easy to use and modify how you like. 
+
+	Started with command line arguments the game runs headless: nothing is drawn, the given number of generations is
+	run as fast as possible and throughput is printed at the end. Run with --help for the arguments.
 */
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //Global functions
 
-//Checks that given string is able to convert to int
+//Checks that given string is able to convert to int, callers check the range they need
 bool isNumber(const std::string &s)
 {
 	if (s.empty())//user just pressed enter
 		return false;
 
-	if (s.length() > 4)//dont allow longer than 4 strings
+	if (s.length() > 9)//longer could overflow int in stoi
 		return false;
 
-	for (int i = 0; i < s.length(); i++)//goes through each char in string, check for numbers and whitespaces
+	for (int i = 0; i < s.length(); i++)//goes through each char in string, check for numbers
 	{
-		if (!(s[i] >= '0' && s[i] <= '9' || !s[i] == ' '))
-		{
-			return false;
-		}
-		else if (stoi(s) > 1000) // 1000 is max numerical im willing to handle this way. feel free to change it but it might brick :D
+		if (!(s[i] >= '0' && s[i] <= '9'))
 		{
 			return false;
 		}
@@ -119,34 +134,126 @@ public:
 	//Contstuctor: gets int width, int height and string initialmode
 	GameOfLife(int boardWidth, int boardHeight, std::string menuChoice);
 
-	//Destructor deletes allocated memory
-	~GameOfLife();
-
 	//updates the board with next generation
 	void onUpdate();
 
-	//draws (outputs) the board into console (# alive . dead)
-	void draw(int newStates[]);
+	//selects the engine used by onUpdate, with verify the reference loop is run alongside and results compared
+	void setEngine(EngineType type, bool verify);
+
+	//number of threads engines step with, 1 is single threaded (reference engine is always single threaded)
+	void setThreads(int threads);
+
+	//what lies beyond the board edge, engines that can't handle the mode are replaced by the reference engine
+	void setBoundary(Boundary boundary);
+
+	//birth and survival rule, B3/S23 by default, engines that can't run the rule are replaced by the reference engine
+	void setRule(const Rule &rule);
+
+	//draws (outputs) the board into console (# alive . dead), only cells that changed since the last frame are written
+	void draw();
+
+	//draws the whole board, needed when something else was printed after the last frame
+	void redraw();
+
+	//runs generations with delayMs between them, the board is drawn on its own thread DISPLAY_FPS times a second
+	void runAuto(int delayMs);
+
+	static const int DISPLAY_FPS = 30;
+
+	//headless game draws nothing
+	void setHeadless(bool headless) { m_headless = headless; }
+
+	//refills the board randomly, fillPercent of the cells alive, same seed gives same board
+	void randomize(unsigned int seed, int fillPercent);
+
+	//replaces the board with an .rle or .cells pattern file placed at x y, cells outside of the board are clipped
+	bool loadPatternFile(const std::string &path, long long x, long long y);
+
+	//writes the board, generation and edges to a checkpoint file
+	bool saveCheckpoint(const std::string &path);
+
+	//continues from an opened checkpoint of the same board size
+	bool loadCheckpoint(const CheckpointReader &checkpoint);
+
+	//streams the statistics of every following generation to a CSV or binary file, see StatsStream.h
+	bool openStats(const std::string &path);
+
+	//flushes and closes the statistics file, returns false when it could not be written completely
+	bool closeStats() { return m_stats.close(); }
+
+	//records written to the statistics file
+	long long statsRecords() const { return m_stats.records(); }
+
+	//starts writing images of every options.every-th generation on a background thread, see FrameExporter.h
+	bool openFrames(const FrameOptions &options);
+
+	//writes the queued frames and stops the writer, returns false when a frame could not be written
+	bool closeFrames() { return m_frames.stop(); }
+
+	const FrameExporter &frames() const { return m_frames; }
+
+	//number of the current generation
+	long long generation() const { return m_generation; }
+
+	const Rule &rule() const { return m_rule; }
+
+	//number of alive cells on the current board
+	long long population();
+
+	//what the engine reports about its last step, empty for the reference engine
+	std::string engineReport() const { return m_engine->stepReport(); }
 
 	//Places individual cells
 	void placeCells();
 
-	//returns the amount of generations before only stills or empty
-	const int getGenerations() { return m_generation; };
+	//returns the amount of generations before the board started repeating itself (stills, oscillators or empty)
+	long long getGenerations() { return m_cycles.found() ? m_cycles.cycleStart() : m_generation; };
 
-	//Flag for game end
+	//returns the length of the cycle the board ended in, 1 for still lifes and empty boards, 0 while no cycle is found
+	long long getPeriod() { return m_cycles.period(); };
+
+	//Flag for game end, set the moment a generation repeats an earlier one
 	bool gameEnd = false;
 
 private:
-	int *m_output;			//holds ouput int array
-	int *m_state;			//itn array that holds current state
-	int m_size;				//holds size of array
-	int m_aliveCount;		//counter that holds number of alive cells
-	int m_failSafeCounter;	//counter that is incemented if alive cells and old cells are equals
+	//runs the reference loop on m_grid, compares it to the engines board and returns the reference stats
+	StepStats verifyEngine(const StepStats &engineStats);
+
+	//starts the hash history from the current board, needed whenever the board is edited
+	void resetHistory();
+
+	//copies the engines board into m_grid if it is out of date
+	void syncState();
+
+	//header lines drawn above the board
+	std::vector<std::string> frameHeader() const;
+
+	//copies the current board into the render threads snapshot and publishes it
+	void publishFrame();
+
+	//hands the current board to the frame writer
+	void exportFrame();
+
+	HaloGrid<int> m_grid;	//current and next generation with a ghost border
+	long long m_size;		//holds size of array
+	long long m_aliveCount;	//counter that holds number of alive cells
 	int m_width;			//holds width of the game array
 	int m_height;			//holds height of the game array
-	int m_generation;		//holds current generation
-	int m_noStateChange;	//holds previous generations number of state changes
+	long long m_generation;	//holds current generation
+	uint64_t m_hash;		//Zobrist hash of the current board
+	CycleDetector m_cycles;	//hashes of earlier generations
+	Rule m_rule;			//birth and survival rule
+
+	EngineType m_engineType;			//engine used by onUpdate
+	std::unique_ptr<LifeEngine> m_engine;	//engine object, holds the board while it runs
+	bool m_verifyEngine;				//compare engine against reference every generation
+	bool m_stateDirty;					//engine is ahead of m_grid
+	std::unique_ptr<ThreadPool> m_pool;	//persistent workers for engines, nullptr when single threaded
+	bool m_headless;					//no console output while running
+	ConsoleRenderer m_renderer;			//keeps the frame on screen for drawing only changes
+	RenderThread *m_renderThread;		//draws snapshots while runAuto is running, nullptr otherwise
+	StatsStream m_stats;				//statistics of every generation, closed when not wanted
+	FrameExporter m_frames;				//images of every Nth generation, stopped when not wanted
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -156,169 +263,508 @@ GameOfLife::GameOfLife(int boardWidth, int boardHeight, std::string menuChoice)
 {
 	m_width = boardWidth;
 	m_height = boardHeight;
-	m_size = boardWidth * boardHeight;
-	m_output = new int[m_width * m_height];
-	m_state = new int[m_width * m_height];
-	memset(m_output, 0, m_width * m_height * sizeof(int));
-	memset(m_state, 0, m_width * m_height * sizeof(int));
+	m_size = (long long)boardWidth * boardHeight;
+	m_aliveCount = 0;
+	m_generation = 0;
+	m_hash = 0;
+	m_engineType = EngineType::Reference;
+	m_verifyEngine = false;
+	m_stateDirty = false;
+	m_headless = false;
+	m_renderThread = nullptr;
+	m_grid.resize(m_width, m_height); //all cells dead
+	m_engine = createEngine(m_engineType);
+
+	//initialization of m_grid
+	if (menuChoice == "1") //random fill with alive and dead cells, a new board every game
+	{
+		randomize(std::random_device()(), 50);
+	}
+	else
+	{
+		resetHistory();
+		m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Draws the cells that changed since the last frame
+void GameOfLife::draw()
+{
+	syncState();
+	m_renderer.render(m_grid.row(0), m_width, m_height, m_grid.stride(), frameHeader());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> GameOfLife::frameHeader() const
+{
+	std::vector<std::string> header;
+	header.push_back("Current generation :  " + std::to_string(m_generation) + "   rule " + ruleString(m_rule) + " ");
+	header.push_back("");
+	if (!m_engine->stepReport().empty())
+	{
+		header.push_back(m_engine->stepReport());
+		header.push_back("");
+	}
+	return header;
+}
 
-	//initialization of m_state
-	if (menuChoice == "1") //random fill with alive and dead cells
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::publishFrame()
+{
+	Snapshot &frame = m_renderThread->frame();
+	frame.width = m_width;
+	frame.height = m_height;
+	frame.cells.resize((size_t)m_width * m_height);
+	if (m_stateDirty) //straight from the engine, m_grid stays out of date
+	{
+		m_engine->store(frame.cells.data(), m_width);
+	}
+	else
 	{
-		for (int i = 0; i < m_size; i++)
+		for (int y = 0; y < m_height; y++)
 		{
-			m_state[i] = rand() % 2;
+			std::copy(m_grid.row(y), m_grid.row(y) + m_width, frame.cells.begin() + (size_t)y * m_width);
 		}
 	}
-	else //fill with dead cells
+	frame.header = frameHeader();
+	m_renderThread->publish();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::redraw()
+{
+	m_renderer.invalidate();
+	draw();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//update loop of the game
+void GameOfLife::onUpdate()
+{
+	StepStats stats;
+	auto phaseStart = std::chrono::steady_clock::now();
+	stats = m_engine->step();
+	if (m_verifyEngine)
+	{
+		stats = verifyEngine(stats);
+	}
+	else
+	{
+		m_stateDirty = true; //m_grid is refreshed only when it is needed
+	}
+	g_phaseTimer.record(Phase::Step, nanosecondsSince(phaseStart));
+	phaseStart = std::chrono::steady_clock::now();
+
+	//Game logic
+	long long aliveBefore = m_aliveCount;
+	m_generation++; //increase generation
+	m_aliveCount = stats.aliveCount;  //save it in member	
+	m_hash ^= stats.hashDelta; //only births and deaths change the hash
+
+	if (m_stats.isOpen())
+	{
+		m_stats.write(m_generation, stats, aliveBefore);
+	}
+
+	if (m_cycles.add(m_hash, m_generation)) //board is the same as in an earlier generation, from here on it only repeats
+	{
+		gameEnd = true;
+	}
+	g_phaseTimer.record(Phase::Statistics, nanosecondsSince(phaseStart));
+
+	if (m_frames.wantsFrame(m_generation))
+	{
+		PhaseScope phase(Phase::Snapshot);
+		exportFrame();
+	}
+
+	if (m_renderThread)
 	{
-		for (int i = 0; i < m_size; i++)
+		if (m_renderThread->wantsFrame()) //generations in between are never shown
 		{
-			m_state[i] = 0;
+			PhaseScope phase(Phase::Snapshot);
+			publishFrame();
 		}
 	}
+	else if (!m_headless)
+	{
+		PhaseScope phase(Phase::Render);
+		draw(); //only births and deaths are written
+	}
+
+	pollPhaseReport(std::cerr); //report signal, printed between generations
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-GameOfLife::~GameOfLife()
+void GameOfLife::runAuto(int delayMs)
 {
-	delete[] m_output;
-	delete[] m_state;
+	RenderThread renderThread(DISPLAY_FPS);
+	m_renderThread = &renderThread;
+	publishFrame();
+	renderThread.start();
+
+	while (!gameEnd && !stopRequested()) //run game loop, drawing happens on the render thread
+	{
+		onUpdate();
+		if (delayMs > 0)
+		{
+			PhaseScope phase(Phase::Sleep);
+			std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+		}
+	}
+
+	publishFrame(); //last generation is always shown
+	renderThread.stop();
+	m_renderThread = nullptr;
+	m_renderer.invalidate(); //screen was drawn by the other renderer
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//Draws the current states of cells.
-void GameOfLife::draw(int newStates[])
-{	
-#ifdef _WIN32
-	clearScreen();
-#elif defined __linux__ // don't know about linux console cursor stuff so i just call system("clear") and output new board
-	system("clear");
-#endif  	
-	
-	std::cout << "Current generation :  " << m_generation << " \n" << std::endl;
-	std::string sOut;
+void GameOfLife::randomize(unsigned int seed, int fillPercent)
+{
+	randomBitBoard(seed, fillPercent, m_width, m_height, m_pool.get(), [this](int y, const uint64_t *words)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			m_grid.at(x, y) = (words[x >> 6] >> (x & 63)) & 1;
+		}
+	});
+	m_stateDirty = false;
+	resetHistory();
+
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //engine continues from the new board
+}
 
-	//visualize output as a grid 
-	int row = 0;
-	for (int i = 0; i < m_size; i++)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GameOfLife::loadPatternFile(const std::string &path, long long x, long long y)
+{
+	auto run = [this](long long runX, long long runY, long long length, bool alive)
 	{
-		row++;
-		if (row == m_width && i != m_size) //When at end of a row add line change
+		if (runY < 0 || runY >= m_height)
 		{
-			sOut = (m_state[i] == 1) ? "#" : ".";
-			std::cout << sOut << std::endl;
-			row = 0;
+			return;
 		}
-		else //No line change
+		long long from = runX < 0 ? 0 : runX;
+		long long to = runX + length > m_width ? m_width : runX + length;
+		for (long long p = from; p < to; p++)
 		{
-			sOut = (m_state[i] == 1) ? "#" : ".";
-			std::cout << sOut;
+			m_grid.at((int)p, (int)runY) = alive ? 1 : 0;
 		}
+	};
+
+	m_grid.clear();
+	PatternInfo info;
+	std::string error;
+	bool loaded = ::loadPatternFile(path, x, y, run, info, error);
+	m_stateDirty = false;
+	resetHistory();
+
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //engine continues from the new board
+
+	if (!loaded)
+	{
+		std::cout << "Could not load pattern: " << error << std::endl;
+		return false;
+	}
+	std::cout << "Pattern " << path << ": " << info.width << " x " << info.height << ", " << info.aliveCells << " alive cells";
+	if (!info.rule.empty())
+	{
+		std::cout << ", rule " << info.rule;
+	}
+	std::cout << std::endl;
+
+	Rule rule;
+	if (!info.rule.empty() && parseRule(info.rule, rule)) //pattern runs with the rule it was made for
+	{
+		setRule(rule);
 	}
+	return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-//update loop of the game
-void GameOfLife::onUpdate()
+bool GameOfLife::saveCheckpoint(const std::string &path)
+{
+	if (m_rule.states > 2)
+	{
+		std::cout << "Could not save checkpoint: it stores one bit per cell, rule " << ruleString(m_rule) << " has " << m_rule.states << " states" << std::endl;
+		return false;
+	}
+	syncState();
+	CheckpointHeader header = {};
+	header.width = m_width;
+	header.height = m_height;
+	header.generation = m_generation;
+	header.hash = zobristHash(m_grid.row(0), m_width, m_height, m_grid.stride()); //m_hash also covers cells off an infinite board
+	header.boundary = (uint32_t)m_grid.boundary();
+	setCheckpointRule(header, ruleString(m_rule));
+
+	std::string error;
+	if (!::saveCheckpoint(path, header, m_grid.row(0), m_grid.stride(), error))
+	{
+		std::cout << "Could not save checkpoint: " << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GameOfLife::loadCheckpoint(const CheckpointReader &checkpoint)
 {
-	//State change counters
-	int noStateChange = 0;
-	int noStateChangeOld = m_noStateChange;	
+	const CheckpointHeader &header = checkpoint.header();
+	if (header.width != (uint64_t)m_width || header.height != (uint64_t)m_height)
+	{
+		std::cout << "Checkpoint board is " << header.width << " x " << header.height << ", not " << m_width << " x " << m_height << std::endl;
+		return false;
+	}
+
+	setBoundary(checkpoint.boundary());
+	Rule rule;
+	if (!parseRule(header.rule, rule))
+	{
+		std::cout << "Checkpoint rule " << header.rule << " is not known, using " << ruleString(rule) << std::endl;
+	}
+	setRule(rule);
+	std::string error;
+	if (!checkpoint.loadCells(m_grid.row(0), m_grid.stride(), error))
+	{
+		std::cout << "Could not load checkpoint: " << error << std::endl;
+		m_grid.clear();
+	}
+	else
+	{
+		m_generation = header.generation;
+	}
+	m_stateDirty = false;
+	resetHistory();
+
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //engine continues from the new board
+	return error.empty();
+}
 
-	//values for checking when there's no changes in alive count --> game is still or dead
-	int aliveCountNew = 0;
-	int oldCount = (m_aliveCount != 0) ? m_aliveCount : 0;
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	//lambda function to return the value in output array on x y coordinates (1 or 0)
-	auto cell = [&](int x, int y)
+bool GameOfLife::openStats(const std::string &path)
+{
+	std::string error;
+	if (!m_stats.open(path, error))
 	{
-		return m_output[y * m_width + x];				
-	};	
+		std::cout << "Could not write statistics: " << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	//store current state to output state 
-	for (int i = 0; i < m_size; i++)
+bool GameOfLife::openFrames(const FrameOptions &options)
+{
+	std::string error;
+	if (!m_frames.start(options, m_width, m_height, error))
+	{
+		std::cout << "Could not write frames: " << error << std::endl;
+		return false;
+	}
+	if (m_frames.wantsFrame(m_generation)) //board the run starts from
 	{
-		m_output[i] = m_state[i];
+		exportFrame();
 	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::exportFrame()
+{
+	syncState(); //engines hand their board over as ints
+	m_frames.submit(m_generation, m_grid.row(0), m_grid.stride());
+}
 
-	//nested for loop to go through all cells
-	for (int x = 0; x < m_width -0; x++)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long GameOfLife::population()
+{
+	syncState();
+	long long population = 0;
+	for (int y = 0; y < m_height; y++)
 	{
-		for (int y = 0; y < m_height -0; y++)
+		for (int x = 0; x < m_width; x++)
 		{
-			/*						Neighbours of one cell
+			population += m_grid.at(x, y) == 1; //dying cells are not alive
+		}
+	}
+	return population;
+}
 
-								x-1 y-1		X-0 y-1			X+1 y-1
-								X-1 y-0	   this cell		X+1 y+0
-								X-1	y+1		X+0 y+1			X+1 y+1
-			*/
-			int nNeighbours = cell(x - 1, y - 1) + cell(x - 0, y - 1) + cell(x + 1, y - 1) +
-							  cell(x - 1, y + 0) +			0		  +	cell(x + 1, y + 0) +
-							  cell(x - 1, y + 1) + cell(x + 0, y + 1) + cell(x + 1, y + 1);
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-			if (cell(x, y) == 1)//when alive...
-			{
-				if ((m_state[y * m_width + x] = nNeighbours == 2 || nNeighbours == 3) == 1)//if it becomes dead, state changed
-				{
-					noStateChange++; //check for when no state changes for oscillators and movers						
-				}
-			}
-			else//not alive...
-			{
-				m_state[y*m_width + x] = nNeighbours == 3; //if it becomes alive		
-			}
+void GameOfLife::setEngine(EngineType type, bool verify)
+{
+	syncState(); //take the board from the previous engine
 
-			//draw cell states
-			#ifdef _WIN32
-				if (cell(x, y) == 1)
-				{
-					setCursorPosition(x, y);
-					std::cout << "#";
-				}
-				else
-				{
-					setCursorPosition(x, y);
-					std::cout << ".";
-				}				
-			#endif // _WIN32
+	m_engineType = type;
+	if (m_grid.boundary() == Boundary::Infinite && type != EngineType::Infinite) //only one engine has a plane beyond the board
+	{
+		std::cout << "Infinite edges run on the infinite engine" << std::endl;
+		m_engineType = EngineType::Infinite;
+	}
+	m_engine = createEngine(m_engineType);
+	if (m_engineType != EngineType::Reference && !m_engine->setBoundary(m_grid.boundary()))
+	{
+		std::cout << "Engine '" << m_engine->name() << "' can't do " << boundaryName(m_grid.boundary()) << " edges, using reference engine" << std::endl;
+		m_engineType = EngineType::Reference;
+		m_engine = createEngine(m_engineType);
+	}
+	else if (m_engineType != EngineType::Reference && !m_engine->setRule(m_rule))
+	{
+		std::cout << "Engine '" << m_engine->name() << "' can't run rule " << ruleString(m_rule) << ", using reference engine" << std::endl;
+		m_engineType = EngineType::Reference;
+		m_engine = createEngine(m_engineType);
+	}
+	if (m_engineType == EngineType::Reference) //runs every rule and every edge but infinite
+	{
+		if (m_grid.boundary() == Boundary::Infinite)
+		{
+			std::cout << "Reference engine stops at the board edge, using dead edges" << std::endl;
+			m_grid.setBoundary(Boundary::Dead);
+		}
+		m_engine->setBoundary(m_grid.boundary());
+		m_engine->setRule(m_rule);
+	}
+	m_verifyEngine = verify && m_engineType != EngineType::Reference && m_grid.boundary() != Boundary::Infinite; //reference loop can't follow cells off the board
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	m_engine->setThreadPool(m_pool.get());
+	std::cout << "Engine: " << m_engine->describe() << std::endl;
+}
 
-			if (m_state[y * m_width + x] == 1)
-			{
-				aliveCountNew++; //get amount of current alive cells
-			}			
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::setThreads(int threads)
+{
+	m_engine->setThreadPool(nullptr); //engine must not use the old pool while it is destroyed
+
+	m_pool.reset();
+	if (threads > 1)
+	{
+		m_pool.reset(new ThreadPool(threads));
+	}
+
+	m_engine->setThreadPool(m_pool.get());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::setBoundary(Boundary boundary)
+{
+	syncState();
+	m_grid.setBoundary(boundary);
+	resetHistory(); //same board develops differently with other edges
+	if (m_engineType != EngineType::Reference || boundary == Boundary::Infinite) //engine is checked for the new mode
+	{
+		setEngine(m_engineType, m_verifyEngine);
+	}
+	else //reference engine does every finite mode
+	{
+		m_engine->setBoundary(boundary);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::setRule(const Rule &rule)
+{
+	syncState();
+	m_rule = rule;
+	for (int y = 0; y < m_height; y++) //states the new rule doesn't have are dead
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			if (m_grid.at(x, y) >= m_rule.states)
+				m_grid.at(x, y) = 0;
 		}
 	}
+	resetHistory(); //earlier generations were made by the old rule
+	if (m_engineType != EngineType::Reference) //engine is checked for the new rule
+	{
+		setEngine(m_engineType, m_verifyEngine);
+	}
+	else //reference engine runs every rule
+	{
+		m_engine->setRule(m_rule);
+		m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride());
+	}
+}
 
-	//Game logic
-	m_generation++; //increase generation
-	m_noStateChange = noStateChange; //save it in member	
-	m_aliveCount = aliveCountNew;  //save it in member	
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	if (m_aliveCount == oldCount) // If they are the same we might be in end condition
+void GameOfLife::resetHistory()
+{
+	m_hash = zobristHash(m_grid.row(0), m_width, m_height, m_grid.stride());
+	m_aliveCount = 0;
+	for (int y = 0; y < m_height; y++)
 	{
-		if (noStateChangeOld == noStateChange) //check also statechange amounts
-		{			
-			 m_failSafeCounter++; //increment failsafe counter, sometimes alive count can be same multiple generations						
+		for (int x = 0; x < m_width; x++)
+		{
+			m_aliveCount += m_grid.at(x, y) == 1; //births and deaths of the next generation are counted from here
 		}
-		else
+	}
+	m_cycles.reset();
+	m_cycles.add(m_hash, m_generation);
+	gameEnd = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//m_grid holds the previous generation when this is called
+StepStats GameOfLife::verifyEngine(const StepStats &engineStats)
+{
+	StepStats referenceStats = stepReferenceGrid(m_grid, m_rule);
+
+	//previous generation buffer is free after the reference step, use it for the engines board
+	int *engineCells = m_grid.nextRow(0);
+	m_engine->store(engineCells, m_grid.stride());
+	int mismatches = 0;
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
 		{
-			m_failSafeCounter = 0; //Reset failsafe counter becouse no concurrent aliveCount
+			if (engineCells[y * m_grid.stride() + x] != m_grid.at(x, y))
+			{
+				mismatches++;
+			}
 		}
-	}	
+	}
 
-	if (m_failSafeCounter == 10 && m_aliveCount == oldCount)//if 10 consecutive generations with exact same alive counts it's highly likely that game is in still or oscillation state 
-	{		
-		m_generation - 10;		
-		gameEnd = true;
+	if (mismatches > 0 || referenceStats.aliveCount != engineStats.aliveCount || referenceStats.survivors != engineStats.survivors ||
+		referenceStats.hashDelta != engineStats.hashDelta || referenceStats.bounds != engineStats.bounds)
+	{
+		std::cout << "Engine '" << m_engine->name() << "' differs from reference at generation " << m_generation + 1 << ": " << mismatches << " cells, alive "
+				  << engineStats.aliveCount << " vs " << referenceStats.aliveCount << std::endl;
+		m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //continue from the reference board
 	}
-	
-#ifdef __linux__
-	draw(m_state); // seperate draw call for linux 
-#endif // !_WIN32
+	m_stateDirty = false;
+	return referenceStats;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GameOfLife::syncState()
+{
+	if (m_stateDirty)
+	{
+		m_engine->store(m_grid.row(0), m_grid.stride());
+	}
+	m_stateDirty = false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -339,7 +785,7 @@ void GameOfLife::placeCells()
 		int p = 0;
 		for (auto c : s) //loop string s
 		{
-			m_state[y * m_width + x + p] = c == L'#' ? 1 : 0; //If string has # character set according state to alive else dead
+			m_grid.at(x + p, y) = c == L'#' ? 1 : 0; //If string has # character set according state to alive else dead
 			p++;
 		}
 	};
@@ -347,6 +793,8 @@ void GameOfLife::placeCells()
 	//set maximum placable cells to 1000 even if there were more possible cells
 	int maxSize = (m_size > 1000) ? 1000 : m_size;	
 
+	syncState(); //cells are placed on top of the current board
+
 	while (!cellNumberAnswer)
 	{
 		std::cout << "How many cells would you like to place? (MAX =" << maxSize << " ): ";
@@ -386,25 +834,694 @@ void GameOfLife::placeCells()
 		}
 		else
 		{
-			draw(m_state); 
+			redraw(); 
 		}		
 	}
+
+	resetHistory();
+	m_engine->load(m_grid.row(0), m_width, m_height, m_grid.stride()); //engine continues from the edited board
 }
 
 //Class side end
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//Main side start
+//Headless side start
 
-int main()
+//Settings of a headless run, filled from command line
+struct BatchOptions
 {
-	//Strings for getlines
-	std::string sMenuChoice;
-	std::string sWidth;
-	std::string sHeight;
+	long long width = 1000;
+	long long height = 1000;
+	bool huge = false;			//board on the huge engine, sides up to HugeEngine::MAX_SIDE
+	unsigned int seed = 1;
+	int fillPercent = 50;
+	Rule rule;				//empty means B3/S23 or the rule of the pattern file or checkpoint
+	bool ruleGiven = false;
+	long long generations = 1000;
+	EngineType engine = EngineType::Reference;
+	bool engineGiven = false;
+	Boundary boundary = Boundary::Dead;
+	int threads = 1;
+	std::string pattern;		//pattern file to start from instead of the random fill
+	long long patternX = 0;
+	long long patternY = 0;
+	std::string resume;			//checkpoint to continue from, its board replaces size, edges and fill
+	std::string checkpoint;		//checkpoint written at the end of the run
+	std::string stats;			//statistics of every generation, .bin is binary and anything else CSV
+	long long checkpointEvery = 0;	//generations between automatic checkpoints, 0 only at the end
+	long long soups = 0;		//random boards to run to their first cycle instead of one board, 0 runs one board
+	FrameOptions frames;		//images of the run, no path writes none
+};
+
+//largest board side in headless mode
+const int MAX_BATCH_SIZE = 16384;
+
+void printUsage()
+{
+	std::cout << "Usage: GoL_AccordingToTask [options]   (no options starts the interactive game)\n"
+			  << "  --width N        board width (default 1000, max " << MAX_BATCH_SIZE << ", " << HugeEngine::MAX_SIDE << " with --huge)\n"
+			  << "  --height N       board height (default 1000, max " << MAX_BATCH_SIZE << ", " << HugeEngine::MAX_SIDE << " with --huge)\n"
+			  << "  --huge           run on the huge engine, memory is only taken where cells live, dead edges only\n"
+			  << "  --seed N         seed of the random fill (default 1)\n"
+			  << "  --fill N         percent of cells alive at start (default 50)\n"
+			  << "  --rule RULE      B/S rulestring like B36/S23, S/B like 23/36, Generations like B2/S/C3 or a name: " << ruleNames() << "\n"
+			  << "  --generations N  generations to run (default 1000)\n"
+			  << "  --engine NAME    " << engineList() << " (default reference)\n"
+			  << "  --edge MODE      dead, torus, mirror or infinite (default dead)\n"
+			  << "  --threads N      threads for the engine (default 1)\n"
+			  << "  --pattern FILE   start from an .rle or .cells pattern instead of the random fill\n"
+			  << "  --pattern-x N    column of the patterns top left corner (default 0)\n"
+			  << "  --pattern-y N    row of the patterns top left corner (default 0)\n"
+			  << "  --resume FILE    continue from a checkpoint, its board size and edges are used\n"
+			  << "  --checkpoint FILE  write a checkpoint at the end of the run\n"
+			  << "  --checkpoint-every N  also write it every N generations\n"
+			  << "  --stats FILE     write population, births, deaths and bounding box of every generation, FILE.bin binary, else CSV\n"
+			  << "  --frames FILE    write every --frame-every generation as FILE.pgm, FILE.png or append it to FILE.raw,\n"
+			  << "                   a run of # in FILE becomes the generation\n"
+			  << "  --frame-every N  generations between frames (default 1)\n"
+			  << "  --frame-scale N  one pixel per N x N cells, gray by the alive share (default 1)\n"
+			  << "  --frame-queue N  frames waiting for the writer at most (default 8)\n"
+			  << "  --frame-policy P drop frames or wait when the queue is full: drop or wait (default drop)\n"
+			  << "  --soups N        run N random boards with seeds from --seed on, up to --generations each, and print how long they last\n"
+			  << "Time per phase is printed at the end, on SIGUSR1 (Ctrl+Break on Windows) and when Ctrl+C stops the run." << std::endl;
+}
+
+//fills options from command line, prints what is wrong and returns false on bad arguments
+bool parseBatchOptions(int argc, char *argv[], BatchOptions &options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		if (arg == "--huge")
+		{
+			options.huge = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << arg << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+		long long number = 0;
+		bool ok = true;
+		if (arg == "--width")
+		{
+			ok = parseNumber(value, 1, HugeEngine::MAX_SIDE, number);
+			options.width = number;
+		}
+		else if (arg == "--height")
+		{
+			ok = parseNumber(value, 1, HugeEngine::MAX_SIDE, number);
+			options.height = number;
+		}
+		else if (arg == "--seed")
+		{
+			ok = parseNumber(value, 0, 0xFFFFFFFFLL, number);
+			options.seed = (unsigned int)number;
+		}
+		else if (arg == "--fill")
+		{
+			ok = parseNumber(value, 0, 100, number);
+			options.fillPercent = (int)number;
+		}
+		else if (arg == "--rule")
+		{
+			ok = parseRule(value, options.rule);
+			options.ruleGiven = true;
+		}
+		else if (arg == "--generations")
+		{
+			ok = parseNumber(value, 0, 1LL << 40, number);
+			options.generations = number;
+		}
+		else if (arg == "--engine")
+		{
+			ok = parseEngine(value, options.engine);
+			options.engineGiven = true;
+		}
+		else if (arg == "--edge")
+		{
+			ok = parseBoundary(value, options.boundary);
+		}
+		else if (arg == "--threads")
+		{
+			ok = parseNumber(value, 1, 256, number);
+			options.threads = (int)number;
+		}
+		else if (arg == "--pattern")
+		{
+			options.pattern = value;
+		}
+		else if (arg == "--pattern-x")
+		{
+			ok = parseNumber(value, -(1LL << 40), 1LL << 40, options.patternX);
+		}
+		else if (arg == "--pattern-y")
+		{
+			ok = parseNumber(value, -(1LL << 40), 1LL << 40, options.patternY);
+		}
+		else if (arg == "--resume")
+		{
+			options.resume = value;
+		}
+		else if (arg == "--checkpoint")
+		{
+			options.checkpoint = value;
+		}
+		else if (arg == "--stats")
+		{
+			options.stats = value;
+		}
+		else if (arg == "--checkpoint-every")
+		{
+			ok = parseNumber(value, 1, 1LL << 40, options.checkpointEvery);
+		}
+		else if (arg == "--frames")
+		{
+			options.frames.path = value;
+		}
+		else if (arg == "--frame-every")
+		{
+			ok = parseNumber(value, 1, 1LL << 40, options.frames.every);
+		}
+		else if (arg == "--frame-scale")
+		{
+			ok = parseNumber(value, 1, MAX_BATCH_SIZE, number);
+			options.frames.scale = (int)number;
+		}
+		else if (arg == "--frame-queue")
+		{
+			ok = parseNumber(value, 1, 1024, number);
+			options.frames.queueFrames = (int)number;
+		}
+		else if (arg == "--frame-policy")
+		{
+			ok = parseFramePolicy(value, options.frames.policy);
+		}
+		else if (arg == "--soups")
+		{
+			ok = parseNumber(value, 1, 1LL << 40, options.soups);
+		}
+		else
+		{
+			std::cout << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+
+		if (!ok)
+		{
+			std::cout << "Bad value '" << value << "' for " << arg << std::endl;
+			return false;
+		}
+	}
+	if (!options.huge && (options.width > MAX_BATCH_SIZE || options.height > MAX_BATCH_SIZE))
+	{
+		std::cout << "Board is larger than " << MAX_BATCH_SIZE << " x " << MAX_BATCH_SIZE << ", use --huge for boards up to " << HugeEngine::MAX_SIDE << " x " << HugeEngine::MAX_SIDE << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//runs the generations on the huge engine, the board never exists as ints
+int runHuge(const BatchOptions &options)
+{
+	if (!options.resume.empty() || !options.checkpoint.empty())
+	{
+		std::cout << "Checkpoints are not supported with --huge" << std::endl;
+		return 1;
+	}
+	if (!options.frames.path.empty())
+	{
+		std::cout << "Frames are not supported with --huge" << std::endl;
+		return 1;
+	}
+	if (options.boundary != Boundary::Dead)
+	{
+		std::cout << "The huge engine only has dead edges" << std::endl;
+		return 1;
+	}
+
+	HugeEngine engine;
+	std::string error;
+	if (!engine.resize(options.width, options.height, error))
+	{
+		std::cout << "Could not make the board: " << error << std::endl;
+		return 1;
+	}
+
+	uint64_t width = engine.width();
+	uint64_t height = engine.height();
+	uint64_t hash = 0;
+	bool setFailed = false;
+	Rule rule;
+	std::unique_ptr<ThreadPool> pool;
+	if (options.threads > 1)
+	{
+		pool.reset(new ThreadPool(options.threads));
+	}
+	if (options.pattern.empty() && fillThreshold(options.fillPercent) > 0) //an empty board is there already
+	{
+		//rows of the board GameOfLife::randomize makes from the seed, a tile row at a time made on the pool and set in order
+		const int BAND_ROWS = HugeEngine::TILE_SIZE;
+		uint32_t threshold = fillThreshold(options.fillPercent);
+		uint64_t words = (width + 63) / 64;
+		std::vector<uint64_t> band(BAND_ROWS * words);
+		uint64_t bandHashes[BAND_ROWS];
+		bool bandAlive[BAND_ROWS];
+		for (uint64_t top = 0; top < height && !setFailed; top += BAND_ROWS)
+		{
+			int rows = (int)std::min<uint64_t>(BAND_ROWS, height - top);
+			auto makeRow = [&](int r)
+			{
+				uint64_t *row = &band[r * words];
+				randomBitRow(options.seed, top + r, threshold, width, row);
+				bandHashes[r] = bitRowHash(row, words, top + r, width);
+				bandAlive[r] = std::any_of(row, row + words, [](uint64_t word) { return word != 0; });
+			};
+			if (pool)
+			{
+				pool->parallelFor(rows, makeRow);
+			}
+			else
+			{
+				for (int r = 0; r < rows; r++)
+				{
+					makeRow(r);
+				}
+			}
+			for (int r = 0; r < rows; r++)
+			{
+				if (bandAlive[r]) //the board starts empty, dead rows and words leave it as it is
+				{
+					setFailed |= !engine.setRow(top + r, &band[r * words]);
+					hash ^= bandHashes[r];
+				}
+			}
+		}
+	}
+	else if (!options.pattern.empty())
+	{
+		auto run = [&](long long runX, long long runY, long long length, bool alive)
+		{
+			if (!alive || runY < 0 || runY >= (long long)height)
+			{
+				return;
+			}
+			long long from = runX < 0 ? 0 : runX;
+			long long to = runX + length > (long long)width ? (long long)width : runX + length;
+			for (long long p = from; p < to; p++)
+			{
+				if (!engine.get(p, runY))
+				{
+					setFailed |= !engine.set(p, runY, true);
+					hash ^= zobristKey((uint64_t)runY * width + p);
+				}
+			}
+		};
+
+		PatternInfo info;
+		if (!loadPatternFile(options.pattern, options.patternX, options.patternY, run, info, error))
+		{
+			std::cout << "Could not load pattern: " << error << std::endl;
+			return 1;
+		}
+		std::cout << "Pattern " << options.pattern << ": " << info.width << " x " << info.height << ", " << info.aliveCells << " alive cells";
+		if (!info.rule.empty())
+		{
+			std::cout << ", rule " << info.rule;
+		}
+		std::cout << std::endl;
+		if (!info.rule.empty())
+		{
+			parseRule(info.rule, rule); //pattern runs with the rule it was made for
+		}
+	}
+	if (setFailed)
+	{
+		std::cout << "Could not make the board: out of memory" << std::endl;
+		return 1;
+	}
+	if (options.ruleGiven) //given rule wins over the one of the pattern
+	{
+		rule = options.rule;
+	}
+	if (!engine.setRule(rule))
+	{
+		std::cout << "The huge engine can't run rule " << ruleString(rule) << ", it has " << rule.states << " states" << std::endl;
+		return 1;
+	}
+
+	engine.setThreadPool(pool.get());
+
+	std::cout << "Board " << width << " x " << height << " (huge), dead edges, rule " << ruleString(rule);
+	if (options.pattern.empty())
+	{
+		std::cout << ", seed " << options.seed << ", fill " << options.fillPercent << "%";
+	}
+	std::cout << ", threads " << options.threads << std::endl;
+
+	StatsStream statsStream;
+	if (!options.stats.empty() && !statsStream.open(options.stats, error))
+	{
+		std::cout << "Could not write statistics: " << error << std::endl;
+		return 1;
+	}
+
+	CycleDetector cycles;
+	cycles.add(hash, 0);
+	long long alive = engine.population();
+	auto start = std::chrono::steady_clock::now();
+	long long generations = 0;
+	for (; generations < options.generations && !stopRequested(); generations++)
+	{
+		auto phaseStart = std::chrono::steady_clock::now();
+		StepStats stats = engine.step();
+		g_phaseTimer.record(Phase::Step, nanosecondsSince(phaseStart));
+		phaseStart = std::chrono::steady_clock::now();
+		hash ^= stats.hashDelta;
+		cycles.add(hash, generations + 1);
+		if (statsStream.isOpen())
+		{
+			statsStream.write(generations + 1, stats, alive);
+		}
+		alive = stats.aliveCount;
+		g_phaseTimer.record(Phase::Statistics, nanosecondsSince(phaseStart));
+		pollPhaseReport(std::cerr);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	engine.setThreadPool(nullptr);
+	if (!statsStream.close())
+	{
+		std::cout << "Could not write statistics to " << options.stats << std::endl;
+		return 1;
+	}
+
+	double cellUpdates = (double)width * height * generations;
+	std::cout << "Generations:         " << generations << " in " << seconds << " s" << (generations < options.generations ? " (stopped)" : "") << std::endl;
+	std::cout << "Generations/s:       " << (seconds > 0 ? generations / seconds : 0.0) << std::endl;
+	std::cout << "Cell updates/s:      " << (seconds > 0 ? cellUpdates / seconds : 0.0) << std::endl;
+	std::cout << "Final population:    " << engine.population() << std::endl;
+	std::cout << "Engine:              " << engine.stepReport() << std::endl;
+	if (cycles.found())
+	{
+		std::cout << "Cycle:               period " << cycles.period() << " from generation " << cycles.cycleStart() << std::endl;
+	}
+	if (!options.stats.empty())
+	{
+		std::cout << "Statistics:          " << statsStream.records() << " generations to " << options.stats << std::endl;
+	}
+	std::cout << "Phases:" << std::endl;
+	g_phaseTimer.report(std::cout);
+	return 0;
+}
+
+//runs an ensemble of random boards to their first cycle and prints the distribution of their lifetimes
+int runEnsemble(const BatchOptions &options)
+{
+	if (options.huge || options.engineGiven || !options.pattern.empty() || !options.resume.empty() || !options.checkpoint.empty() ||
+		!options.stats.empty() || !options.frames.path.empty())
+	{
+		std::cout << "--soups runs random boards on its own packed boards only, without --huge, --engine, patterns, checkpoints, statistics or frames" << std::endl;
+		return 1;
+	}
+	if (options.boundary != Boundary::Dead)
+	{
+		std::cout << "Soups only run with dead edges" << std::endl;
+		return 1;
+	}
+	if (options.rule.states > 2)
+	{
+		std::cout << "Soups can't run rule " << ruleString(options.rule) << ", it has " << options.rule.states << " states" << std::endl;
+		return 1;
+	}
+
+	SoupOptions soupOptions;
+	soupOptions.width = (int)options.width;
+	soupOptions.height = (int)options.height;
+	soupOptions.fillPercent = options.fillPercent;
+	soupOptions.firstSeed = options.seed;
+	soupOptions.soups = options.soups;
+	soupOptions.maxGenerations = options.generations;
+	soupOptions.rule = options.rule;
+
+	std::unique_ptr<ThreadPool> pool;
+	if (options.threads > 1)
+	{
+		pool.reset(new ThreadPool(options.threads));
+	}
+
+	std::cout << "Soups " << options.soups << " of " << options.width << " x " << options.height << ", dead edges, rule " << ruleString(options.rule)
+			  << ", seeds " << options.seed << " - " << options.seed + options.soups - 1 << ", fill " << options.fillPercent << "%"
+			  << ", up to " << options.generations << " generations, threads " << options.threads << std::endl;
+
+	SoupTotals totals;
+	auto start = std::chrono::steady_clock::now();
+	runSoups(soupOptions, pool.get(), totals, [] { return stopRequested(); });
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	long long unsettled = totals.soups - totals.settled;
+	std::cout << "Soups run:           " << totals.soups << " in " << seconds << " s" << (totals.soups < options.soups ? " (stopped)" : "") << std::endl;
+	std::cout << "Settled:             " << totals.settled << ", " << unsettled << " still changing after " << options.generations << " generations" << std::endl;
+	if (totals.settled > 0)
+	{
+		//median from the bins, as the bin it falls into
+		long long seen = 0;
+		int medianBin = 0;
+		while (seen + totals.lifetimes[medianBin] < (totals.settled + 1) / 2)
+		{
+			seen += totals.lifetimes[medianBin++];
+		}
+		long long medianLow = medianBin == 0 ? 0 : 1LL << (medianBin - 1);
+		long long medianHigh = medianBin == 0 ? 0 : (1LL << medianBin) - 1;
+		std::cout << "Lifetime:            mean " << (double)totals.lifetimeSum / totals.settled << ", median " << medianLow << " - " << medianHigh
+				  << ", longest " << totals.longestLifetime << " (seed " << totals.longestSeed << ")" << std::endl;
+
+		std::cout << "Lifetimes:" << std::endl;
+		long long most = *std::max_element(totals.lifetimes, totals.lifetimes + SoupTotals::LIFETIME_BINS);
+		for (int bin = 0; bin < SoupTotals::LIFETIME_BINS; bin++)
+		{
+			if (totals.lifetimes[bin] == 0)
+			{
+				continue;
+			}
+			long long low = bin == 0 ? 0 : 1LL << (bin - 1);
+			long long high = bin == 0 ? 0 : (1LL << bin) - 1;
+			char line[128];
+			snprintf(line, sizeof(line), "  %10lld - %-10lld %10lld  ", low, high, totals.lifetimes[bin]);
+			std::cout << line << std::string((size_t)(totals.lifetimes[bin] * 40 / most), '#') << std::endl;
+		}
+
+		std::cout << "Periods:            ";
+		for (int period = 1; period <= SoupTotals::MAX_PERIOD; period++)
+		{
+			if (totals.periods[period] > 0)
+			{
+				std::cout << " " << period << ": " << totals.periods[period];
+			}
+		}
+		if (totals.periods[0] > 0)
+		{
+			std::cout << " over " << SoupTotals::MAX_PERIOD << ": " << totals.periods[0];
+		}
+		std::cout << std::endl;
+	}
+	if (totals.soups > 0)
+	{
+		std::cout << "Final population:    mean " << (double)totals.populationSum / totals.soups << ", min " << totals.populationMin << ", max " << totals.populationMax << std::endl;
+	}
+	double cellUpdates = (double)options.width * options.height * totals.generations;
+	std::cout << "Soups/s:             " << (seconds > 0 ? totals.soups / seconds : 0.0) << std::endl;
+	std::cout << "Generations/s:       " << (seconds > 0 ? totals.generations / seconds : 0.0) << " (" << totals.generations << " in all)" << std::endl;
+	std::cout << "Cell updates/s:      " << (seconds > 0 ? cellUpdates / seconds : 0.0) << std::endl;
+	return 0;
+}
+
+//runs the generations without drawing and prints throughput
+int runBatch(const BatchOptions &options)
+{
+	if (options.soups > 0)
+	{
+		return runEnsemble(options);
+	}
+	if (options.huge)
+	{
+		return runHuge(options);
+	}
+
+	int width = (int)options.width;
+	int height = (int)options.height;
+	Boundary boundary = options.boundary;
+	CheckpointReader checkpoint;
+	if (!options.resume.empty())
+	{
+		std::string error;
+		if (!checkpoint.open(options.resume, error))
+		{
+			std::cout << "Could not resume: " << error << std::endl;
+			return 1;
+		}
+		if (checkpoint.header().width > MAX_BATCH_SIZE || checkpoint.header().height > MAX_BATCH_SIZE)
+		{
+			std::cout << "Could not resume: board is larger than " << MAX_BATCH_SIZE << " x " << MAX_BATCH_SIZE << std::endl;
+			return 1;
+		}
+		width = (int)checkpoint.header().width;
+		height = (int)checkpoint.header().height;
+		boundary = checkpoint.boundary();
+	}
+
+	GameOfLife game(width, height, "2");
+	game.setHeadless(true);
+	game.setBoundary(boundary);
+	game.setThreads(options.threads);
+	if (!options.resume.empty())
+	{
+		if (!game.loadCheckpoint(checkpoint))
+		{
+			return 1;
+		}
+	}
+	else if (options.pattern.empty())
+	{
+		game.randomize(options.seed, options.fillPercent);
+	}
+	else if (!game.loadPatternFile(options.pattern, options.patternX, options.patternY))
+	{
+		return 1;
+	}
+	if (options.ruleGiven) //given rule wins over the one of the pattern or checkpoint
+	{
+		game.setRule(options.rule);
+	}
+	game.setEngine(options.engine, false);
+	if (!options.stats.empty() && !game.openStats(options.stats))
+	{
+		return 1;
+	}
+	if (!options.frames.path.empty() && !game.openFrames(options.frames))
+	{
+		return 1;
+	}
+
+	std::cout << "Board " << width << " x " << height << ", " << boundaryName(boundary) << " edges, rule " << ruleString(game.rule());
+	if (!options.resume.empty())
+	{
+		std::cout << ", resumed at generation " << game.generation();
+	}
+	else if (options.pattern.empty())
+	{
+		std::cout << ", seed " << options.seed << ", fill " << options.fillPercent << "%";
+	}
+	std::cout << ", threads " << options.threads << std::endl;
+
+	int checkpoints = 0;
+	double checkpointSeconds = 0;
+	auto save = [&]()
+	{
+		auto saveStart = std::chrono::steady_clock::now();
+		bool saved = game.saveCheckpoint(options.checkpoint);
+		checkpointSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - saveStart).count();
+		checkpoints++;
+		return saved;
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	long long generations = 0;
+	for (; generations < options.generations && !stopRequested(); generations++)
+	{
+		game.onUpdate();
+		if (options.checkpointEvery > 0 && !options.checkpoint.empty() && (generations + 1) % options.checkpointEvery == 0 && generations + 1 < options.generations)
+		{
+			save();
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - checkpointSeconds;
+	if (!options.checkpoint.empty() && !save())
+	{
+		return 1;
+	}
+	if (!options.stats.empty() && !game.closeStats())
+	{
+		std::cout << "Could not write statistics to " << options.stats << std::endl;
+		return 1;
+	}
+	if (!options.frames.path.empty() && !game.closeFrames())
+	{
+		std::cout << "Could not write frames to " << options.frames.path << std::endl;
+		return 1;
+	}
+
+	double cellUpdates = (double)width * height * generations;
+	std::cout << "Generations:         " << generations << " in " << seconds << " s" << (generations < options.generations ? " (stopped)" : "") << std::endl;
+	std::cout << "Generations/s:       " << (seconds > 0 ? generations / seconds : 0.0) << std::endl;
+	std::cout << "Cell updates/s:      " << (seconds > 0 ? cellUpdates / seconds : 0.0) << std::endl;
+	std::cout << "Final population:    " << game.population() << std::endl;
+	if (!game.engineReport().empty())
+	{
+		std::cout << "Engine:              " << game.engineReport() << std::endl;
+	}
+	if (game.gameEnd)
+	{
+		std::cout << "Cycle:               period " << game.getPeriod() << " from generation " << game.getGenerations() << std::endl;
+	}
+	if (checkpoints > 0)
+	{
+		std::cout << "Checkpoints:         " << checkpoints << " to " << options.checkpoint << " in " << checkpointSeconds << " s, last at generation " << game.generation() << std::endl;
+	}
+	if (!options.stats.empty())
+	{
+		std::cout << "Statistics:          " << game.statsRecords() << " generations to " << options.stats << std::endl;
+	}
+	if (!options.frames.path.empty())
+	{
+		const FrameExporter &frames = game.frames();
+		std::cout << "Frames:              " << frames.framesWritten() << " of " << frames.imageWidth() << " x " << frames.imageHeight() << " to " << options.frames.path
+				  << ", " << frames.framesDropped() << " dropped, " << frames.bytesWritten() / (1024.0 * 1024.0) << " MB" << std::endl;
+	}
+	std::cout << "Phases:" << std::endl;
+	g_phaseTimer.report(std::cout);
+	return 0;
+}
+
+//Headless side end
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//Main side start
+
+int main(int argc, char *argv[])
+{
+	installPhaseSignals(); //report on SIGUSR1 or Ctrl+Break, stop on Ctrl+C
+
+	//any argument means headless batch run
+	if (argc > 1)
+	{
+		BatchOptions options;
+		if (!parseBatchOptions(argc, argv, options))
+		{
+			printUsage();
+			return 1;
+		}
+		return runBatch(options);
+	}
+
+	//Strings for getlines
+	std::string sMenuChoice;
+	std::string sWidth;
+	std::string sHeight;
 	std::string sUpdateTime;
 	std::string sStyleChoice;
 	std::string sSpace;
 	std::string sRestart;
+	std::string sEngine;
+	std::string sVerify;
+	std::string sThreads;
+	std::string sBoundary;
+	std::string sCheckpoint;
+	std::string sRule;
 	
 	//Checks for user input while loops
 	bool restartChoice = false;
@@ -414,8 +1531,17 @@ int main()
 	bool modeAnswer = false;
 	bool timerAnswer = false;
 	bool manualStartAnswer = false;
+	bool engineAnswer = false;
+	bool boundaryAnswer = false;
+	bool ruleAnswer = false;
 	bool space = false;
 
+	EngineType engineType = EngineType::Reference;
+	Boundary boundary = Boundary::Dead;
+	Rule rule;
+	bool verifyEngine = false;
+	CheckpointReader checkpoint;	//board to resume from, menu choice 3
+
 	//START	
 	while (!restartChoice)
 	{
@@ -424,29 +1550,102 @@ int main()
 			std::cout << "Game of Life \n" << std::endl;
 			std::cout << "(1) Build random board " << std::endl;
 			std::cout << "(2) Build your own board " << std::endl;
+			std::cout << "(3) Resume from checkpoint file " << std::endl;
 			std::getline(std::cin, sMenuChoice);
 			if (sMenuChoice == "1" || sMenuChoice == "2")
 			{
 				menuChoice = true;
 			}
+			else if (sMenuChoice == "3")
+			{
+				std::string error;
+				std::cout << "Give checkpoint file" << std::endl;
+				std::getline(std::cin, sCheckpoint);
+				if (checkpoint.open(sCheckpoint, error) && checkpoint.header().width <= 1000 && checkpoint.header().height <= 1000)
+				{
+					//board size and edges come from the checkpoint
+					sWidth = std::to_string(checkpoint.header().width);
+					sHeight = std::to_string(checkpoint.header().height);
+					boundary = checkpoint.boundary();
+					boardAnswer = true;
+					boundaryAnswer = true;
+					ruleAnswer = true; //rule comes from the checkpoint too
+					menuChoice = true;
+				}
+				else
+				{
+					std::cout << (error.empty() ? "Checkpoint board is too large to show" : error) << std::endl;
+				}
+			}
 		}
 		while (!boardAnswer) //Wait for usable board answer
 		{
 			std::cout << "Give size of the board WIDTH x HEIGHT (MAX = 360 x 360)\n" << std::endl;
 			std::getline(std::cin, sWidth);
 			std::getline(std::cin, sHeight);
-			if (isNumber(sWidth) && isNumber(sHeight) && stoi(sWidth) < 360 && stoi(sWidth) < 360)
+			if (isNumber(sWidth) && isNumber(sHeight) && stoi(sWidth) < 360 && stoi(sHeight) < 360)
 			{
 				boardAnswer = true;
 			}
 		}
 
+		while (!boundaryAnswer) //Wait for usable edge answer
+		{
+			std::cout << "Give board edge 'dead', 'torus' (wraps around), 'mirror' or 'infinite' (board is a window onto an unbounded plane)" << std::endl;
+			std::getline(std::cin, sBoundary);
+			if (parseBoundary(sBoundary, boundary))
+			{
+				boundaryAnswer = true;
+			}
+		}
+
+		while (!ruleAnswer) //Wait for usable rule answer
+		{
+			std::cout << "Give rule as B/S rulestring like B36/S23, Generations rule like B2/S/C3 or one of " << ruleNames() << " (empty for B3/S23)" << std::endl;
+			std::getline(std::cin, sRule);
+			if (sRule.empty() || parseRule(sRule, rule))
+			{
+				ruleAnswer = true;
+			}
+		}
+
 		//create game object instance
 		GameOfLife game(stoi(sWidth), stoi(sHeight), sMenuChoice);
+		game.setBoundary(boundary);
+		game.setRule(rule);
 		if (sMenuChoice == "2") // handle building board 
 		{
 			game.placeCells();
 		}
+		else if (sMenuChoice == "3")
+		{
+			game.loadCheckpoint(checkpoint);
+		}
+
+		//Select simulation engine
+		while (!engineAnswer) //Wait for usable engine answer
+		{
+			std::cout << "Give simulation engine (" << engineList() << ")" << std::endl;
+			std::getline(std::cin, sEngine);
+			if (parseEngine(sEngine, engineType))
+			{
+				engineAnswer = true;
+			}
+		}
+		if (engineType != EngineType::Reference && sVerify.empty())
+		{
+			std::cout << "Compare every generation against reference engine? (Y,N)" << std::endl;
+			std::getline(std::cin, sVerify);
+			verifyEngine = (sVerify == "y" || sVerify == "Y");
+
+			while (!isNumber(sThreads) || stoi(sThreads) < 1) //Wait for usable thread count
+			{
+				std::cout << "Give number of threads (1 - " << std::thread::hardware_concurrency() << ")" << std::endl;
+				std::getline(std::cin, sThreads);
+			}
+		}
+		game.setThreads(sThreads.empty() ? 1 : stoi(sThreads));
+		game.setEngine(engineType, verifyEngine);
 
 		//Select game mode, auto or manual	
 		while (!modeAnswer) //Wait for usable board answer
@@ -460,7 +1659,7 @@ int main()
 		}
 
 		//User wanted automatic generations
-		std::cout << "Give timer length as ms (larger boards take longer to output) : ";
+		std::cout << "Give timer length as ms (0 runs at full speed, display refreshes " << GameOfLife::DISPLAY_FPS << " times a second) : ";
 		if (sStyleChoice == "1")
 		{
 			while (!timerAnswer) //Wait for usable board answer
@@ -476,31 +1675,24 @@ int main()
 				}
 			}
 
-			#ifdef _WIN32
-				clearScreen();
-			#elif defined __linux__
-				system("clear")
-			#endif // _WIN32		
-
-			while (!game.gameEnd) //run game loop
+			game.runAuto(stoi(sUpdateTime));
+			if (stopRequested())
 			{
-				game.onUpdate();
-				std::this_thread::sleep_for(std::chrono::milliseconds(stoi(sUpdateTime)));
+				g_phaseTimer.report(std::cout);
+				return 0;
 			}
 
-			std::cout << "Game lasted for: " << game.getGenerations() << " generations" << std::endl;
+			std::cout << "Game lasted for: " << game.getGenerations() << " generations, then repeats every " << game.getPeriod() << std::endl;
 		}
 		else //user wanted manual generations
 		{
 
-			#ifdef _WIN32
-						clearScreen();
-			#elif defined __linux__
-						system("clear")
-			#endif // _WIN32
+			game.redraw(); //later generations only write the cells that changed
 
+#ifdef _WIN32
 			std::cout << "Press space" << std::endl;
-			while (!game.gameEnd)
+			auto inputStart = std::chrono::steady_clock::now(); //waiting for the key is the input phase
+			while (!game.gameEnd && !stopRequested())
 			{
 				if (GetAsyncKeyState(VK_SPACE) < 0 && space == false)
 				{
@@ -508,19 +1700,40 @@ int main()
 				}
 				if (GetAsyncKeyState(VK_SPACE) == 0 && space == true) //only proceed after space is released
 				{
+					g_phaseTimer.record(Phase::Input, nanosecondsSince(inputStart));
 					game.onUpdate();
 					space = false;
+					inputStart = std::chrono::steady_clock::now();
 				}
 			}
-			std::cout << "Game lasted for: " << game.getGenerations() << " generations" << std::endl;
+#elif defined __linux__
+			std::cout << "Press enter" << std::endl; //no key state polling in a plain terminal, every line is one generation
+			while (!game.gameEnd && !stopRequested())
+			{
+				{
+					PhaseScope phase(Phase::Input);
+					std::getline(std::cin, sSpace);
+				}
+				game.onUpdate();
+			}
+#endif // _WIN32
+			std::cout << "Game lasted for: " << game.getGenerations() << " generations, then repeats every " << game.getPeriod() << std::endl;
 			std::cin.get(); //just to keep game closing before seeing generations
 		}
 
+		std::cout << "\nSave board to checkpoint file? (file name, empty skips)" << std::endl;
+		std::getline(std::cin, sCheckpoint);
+		if (!sCheckpoint.empty() && game.saveCheckpoint(sCheckpoint))
+		{
+			std::cout << "Saved generation " << game.generation() << " to " << sCheckpoint << std::endl;
+		}
+
 		std::cout << "\n RESTART? (Y,N)" << std::endl;
 		std::getline(std::cin, sRestart);
 
 		if (sRestart == "n" || sRestart == "N")
 		{
+			g_phaseTimer.report(std::cout); //where the time of all games went
 			return 0;
 		}
 	}
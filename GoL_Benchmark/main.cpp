@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <memory>
+#include "../Common/Engines.h"
+#include "../Common/CommandLine.h"
+#include "../Common/RandomFill.h"
+
+/**
+	STEP KERNEL BENCHMARK
+		- times LifeEngine::step on its own, no drawing and no game logic
+
+	Every engine is run on random boards of every size and density of the sweep. A case steps the board until it has
+	run for the minimum time (and at least a few generations) and reports nanoseconds per cell update and cells per second.
+	The reference engine is the original int loop of GameOfLife, the baseline the other engines are compared with.
+	Engines run with dead edges, the infinite engine can't and runs its board as a window onto the unbounded plane,
+	where cells leaving the board live on. Every row says which edges it ran with.
+
+	Results go out as CSV or JSON, progress goes to stderr so the results can be redirected into a file.
+*/
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//Global functions
+
+//Settings of the sweep, filled from command line
+struct BenchmarkOptions
+{
+	int minSize = 32;						//boards are square, sizes double from min to max
+	int maxSize = 16384;
+	std::vector<int> densities = { 1, 5, 10, 25, 50 };	//percent of cells alive at start
+	std::vector<EngineType> engines;		//empty runs every engine, reference included
+	int threads = 1;
+	Rule rule;								//B3/S23 unless --rule is given
+	double minSeconds = 0.25;				//minimum timed run per case
+	int minGenerations = 3;
+	unsigned int seed = 1;
+	bool json = false;
+	std::string outFile;					//empty writes to stdout
+};
+
+//One measured case
+struct BenchmarkResult
+{
+	std::string engine;
+	std::string kernel;
+	std::string rule;
+	std::string edges;			//dead, or infinite for the unbounded plane
+	int width;
+	int height;
+	int density;
+	int threads;
+	long long generations;
+	double seconds;
+	double nsPerCell;
+	double cellsPerSecond;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void printUsage()
+{
+	std::cout << "Usage: GoL_Benchmark [options]\n"
+			  << "  --min-size N      smallest board side (default 32)\n"
+			  << "  --max-size N      largest board side (default 16384), sides double from min to max\n"
+			  << "  --densities LIST  comma separated alive percents (default 1,5,10,25,50)\n"
+			  << "  --engines LIST    comma separated engines (default all)\n"
+			  << "  --threads N       threads for the engines (default 1)\n"
+			  << "  --rule RULE       B/S or Generations (B2/S/C3) rulestring or rule name (default B3/S23)\n"
+			  << "  --seconds T       minimum timed run per case (default 0.25)\n"
+			  << "  --seed N          seed of the random boards (default 1)\n"
+			  << "  --format FORMAT   csv or json (default csv)\n"
+			  << "  --out FILE        write results into file instead of stdout" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//fills options from command line, prints what is wrong and returns false on bad arguments
+bool parseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions &options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << arg << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+		long long number = 0;
+		bool ok = true;
+		if (arg == "--min-size")
+		{
+			ok = parseNumber(value, 1, 1 << 16, number);
+			options.minSize = (int)number;
+		}
+		else if (arg == "--max-size")
+		{
+			ok = parseNumber(value, 1, 1 << 16, number);
+			options.maxSize = (int)number;
+		}
+		else if (arg == "--densities")
+		{
+			options.densities.clear();
+			for (const std::string &item : splitList(value))
+			{
+				ok = ok && parseNumber(item, 0, 100, number);
+				options.densities.push_back((int)number);
+			}
+		}
+		else if (arg == "--engines")
+		{
+			options.engines.clear();
+			for (const std::string &item : splitList(value))
+			{
+				EngineType type = EngineType::Reference;
+				ok = ok && parseEngine(item, type);
+				options.engines.push_back(type);
+			}
+		}
+		else if (arg == "--threads")
+		{
+			ok = parseNumber(value, 1, 256, number);
+			options.threads = (int)number;
+		}
+		else if (arg == "--rule")
+		{
+			ok = parseRule(value, options.rule);
+		}
+		else if (arg == "--seconds")
+		{
+			char *end = nullptr;
+			options.minSeconds = strtod(value.c_str(), &end);
+			ok = *end == '\0' && options.minSeconds >= 0;
+		}
+		else if (arg == "--seed")
+		{
+			ok = parseNumber(value, 0, 0xFFFFFFFFLL, number);
+			options.seed = (unsigned int)number;
+		}
+		else if (arg == "--format")
+		{
+			ok = value == "csv" || value == "json";
+			options.json = value == "json";
+		}
+		else if (arg == "--out")
+		{
+			options.outFile = value;
+		}
+		else
+		{
+			std::cout << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+
+		if (!ok)
+		{
+			std::cout << "Bad value '" << value << "' for " << arg << std::endl;
+			return false;
+		}
+	}
+
+	if (options.minSize > options.maxSize)
+	{
+		std::cout << "--min-size is larger than --max-size" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//random int board, density percent of the cells alive
+void randomBoard(std::vector<int> &cells, int width, int height, int density, unsigned int seed)
+{
+	cells.resize((size_t)width * height);
+	randomBitBoard(seed, density, width, height, nullptr, [&](int y, const uint64_t *words)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			cells[(size_t)y * width + x] = (words[x >> 6] >> (x & 63)) & 1;
+		}
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//steps the loaded engine until minimum time and generations are reached
+BenchmarkResult runCase(LifeEngine &engine, Boundary edges, int width, int height, int density, const BenchmarkOptions &options)
+{
+	engine.step(); //warm up caches and lazy allocations
+
+	long long generations = 0;
+	double seconds = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	while (generations < options.minGenerations || seconds < options.minSeconds)
+	{
+		engine.step();
+		generations++;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double cellUpdates = (double)width * height * generations;
+
+	BenchmarkResult result;
+	result.engine = engine.name();
+	result.kernel = engine.describe();
+	result.rule = ruleString(engine.rule());
+	result.edges = boundaryName(edges);
+	result.width = width;
+	result.height = height;
+	result.density = density;
+	result.threads = options.threads;
+	result.generations = generations;
+	result.seconds = seconds;
+	result.nsPerCell = seconds * 1e9 / cellUpdates;
+	result.cellsPerSecond = cellUpdates / seconds;
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void writeCsv(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+	out << "engine,kernel,rule,edges,width,height,density,threads,generations,seconds,ns_per_cell,cells_per_second\n";
+	char line[512];
+	for (const BenchmarkResult &r : results)
+	{
+		snprintf(line, sizeof(line), "%s,%s,%s,%s,%d,%d,%d,%d,%lld,%.6f,%.4f,%.6e\n", r.engine.c_str(), r.kernel.c_str(), r.rule.c_str(), r.edges.c_str(),
+				 r.width, r.height, r.density, r.threads, r.generations, r.seconds, r.nsPerCell, r.cellsPerSecond);
+		out << line;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void writeJson(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+	out << "[\n";
+	char line[512];
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &r = results[i];
+		snprintf(line, sizeof(line), "  {\"engine\": \"%s\", \"kernel\": \"%s\", \"rule\": \"%s\", \"edges\": \"%s\", \"width\": %d, \"height\": %d, \"density\": %d, \"threads\": %d, "
+				 "\"generations\": %lld, \"seconds\": %.6f, \"ns_per_cell\": %.4f, \"cells_per_second\": %.6e}%s\n",
+				 r.engine.c_str(), r.kernel.c_str(), r.rule.c_str(), r.edges.c_str(), r.width, r.height, r.density, r.threads,
+				 r.generations, r.seconds, r.nsPerCell, r.cellsPerSecond, i + 1 < results.size() ? "," : "");
+		out << line;
+	}
+	out << "]\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//Main side start
+
+int main(int argc, char *argv[])
+{
+	BenchmarkOptions options;
+	if (!parseBenchmarkOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (options.engines.empty())
+	{
+		for (const EngineInfo &info : g_engines)
+		{
+			options.engines.push_back(info.type);
+		}
+	}
+
+	std::unique_ptr<ThreadPool> pool;
+	if (options.threads > 1)
+	{
+		pool.reset(new ThreadPool(options.threads));
+	}
+
+	std::vector<BenchmarkResult> results;
+	std::vector<int> cells;
+	for (int size = options.minSize; size <= options.maxSize; size *= 2)
+	{
+		for (int density : options.densities)
+		{
+			//same board for every engine of the case
+			randomBoard(cells, size, size, density, options.seed);
+			for (EngineType type : options.engines)
+			{
+				std::unique_ptr<LifeEngine> engine = createEngine(type);
+				engine->setThreadPool(pool.get());
+				if (!engine->setRule(options.rule))
+				{
+					std::cerr << engine->name() << " can't run rule " << ruleString(options.rule) << ", skipped" << std::endl;
+					continue;
+				}
+				//dead edges where the engine has them, the infinite engine only runs the unbounded plane
+				Boundary edges = Boundary::Dead;
+				if (!engine->setBoundary(edges))
+				{
+					edges = Boundary::Infinite;
+					engine->setBoundary(edges);
+				}
+				engine->load(cells.data(), size, size, size);
+
+				results.push_back(runCase(*engine, edges, size, size, density, options));
+				const BenchmarkResult &r = results.back();
+				std::cerr << r.kernel << " " << r.edges << " edges " << size << "x" << size << " " << density << "%: " << r.nsPerCell << " ns/cell, " << r.cellsPerSecond << " cells/s" << std::endl;
+			}
+		}
+	}
+
+	std::ofstream file;
+	if (!options.outFile.empty())
+	{
+		file.open(options.outFile);
+		if (!file)
+		{
+			std::cout << "Can't write " << options.outFile << std::endl;
+			return 1;
+		}
+	}
+	std::ostream &out = options.outFile.empty() ? std::cout : file;
+
+	if (options.json)
+	{
+		writeJson(out, results);
+	}
+	else
+	{
+		writeCsv(out, results);
+	}
+	return 0;
+}
+	//End of main
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////